@@ -302,6 +302,32 @@ end
 
 dependencies.imports()
 
+project "tests"
+kind "ConsoleApp"
+language "C++"
+
+files {"./src/tests/**.hpp", "./src/tests/**.cpp", "./src/launcher/updater/binary_manifest.cpp", "./src/launcher/updater/update_journal.cpp"}
+
+-- ./src/tests comes first, so launcher sources pick up its std_include.hpp instead of the CEF one
+includedirs {"./src/tests", "./src/launcher", "./src/common", "%{prj.location}/src"}
+
+links {"common"}
+
+dependencies.imports()
+
+project "benchmarks"
+kind "ConsoleApp"
+language "C++"
+
+files {"./src/benchmarks/**.hpp", "./src/benchmarks/**.cpp", "./src/launcher/updater/binary_manifest.cpp", "./src/launcher/updater/manifest_parser.cpp", "./src/launcher/updater/data_path_table.cpp"}
+
+-- ./src/benchmarks comes first, so launcher sources pick up its std_include.hpp instead of the CEF one
+includedirs {"./src/benchmarks", "./src/launcher", "./src/common", "%{prj.location}/src"}
+
+links {"common"}
+
+dependencies.imports()
+
 group "Dependencies"
 dependencies.projects()
 
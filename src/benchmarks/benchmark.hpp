@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+namespace benchmarks
+{
+	using benchmark_function = void(*)();
+
+	bool register_benchmark(const char* name, benchmark_function function);
+
+	// Prints one measured value, aligned with the others of the run
+	void report(const std::string& label, double value, const char* unit);
+
+	// Results are added here, so the measured work can't be optimized away
+	inline volatile size_t sink = 0;
+
+	// Repeats the function for at least the given time after a warm-up run, returns the mean time of one run in seconds
+	template <typename F>
+	double measure(F&& function, const std::chrono::milliseconds min_time = std::chrono::milliseconds(500))
+	{
+		function();
+
+		size_t runs = 0;
+		const auto start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::duration elapsed{};
+
+		do
+		{
+			function();
+			++runs;
+			elapsed = std::chrono::steady_clock::now() - start;
+		}
+		while (elapsed < min_time);
+
+		return std::chrono::duration<double>(elapsed).count() / static_cast<double>(runs);
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const bool name##_registered = benchmarks::register_benchmark(#name, name); \
+	static void name()
@@ -0,0 +1,177 @@
+#include "benchmark.hpp"
+
+#include <std_include.hpp>
+
+#include <updater/binary_manifest.hpp>
+#include <updater/data_path_table.hpp>
+
+#include <cstdio>
+
+namespace
+{
+	constexpr size_t file_count = 50'000;
+
+	// Only a sample of the entries is classified the old way, all of them would take hours
+	constexpr size_t nested_loop_sample = 500;
+
+	struct disk_entry
+	{
+		std::filesystem::path path;
+		bool is_directory;
+	};
+
+	std::vector<std::string> generate_names()
+	{
+		std::vector<std::string> names{};
+		names.reserve(file_count);
+
+		for (size_t i = 0; i < file_count; ++i)
+		{
+			names.emplace_back("zone/folder" + std::to_string(i % 250) + "/sub" + std::to_string(i % 7) + "/file" + std::to_string(i) + ".ff");
+		}
+
+		std::ranges::sort(names);
+		return names;
+	}
+
+	// Every manifest file and folder, plus one stale file in a hundred and a few stale folders
+	std::vector<disk_entry> generate_entries(const std::filesystem::path& base, const std::vector<std::string>& names)
+	{
+		std::set<std::string> folders{};
+		std::vector<disk_entry> entries{};
+
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			const auto& name = names[i];
+			for (auto separator = name.find('/'); separator != std::string::npos; separator = name.find('/', separator + 1))
+			{
+				folders.emplace(name.substr(0, separator));
+			}
+
+			entries.push_back({base / name, false});
+
+			if (i % 100 == 0)
+			{
+				entries.push_back({base / (name + ".old"), false});
+			}
+		}
+
+		for (size_t i = 0; i < 10; ++i)
+		{
+			folders.emplace("removed" + std::to_string(i));
+		}
+
+		for (const auto& folder : folders)
+		{
+			entries.push_back({base / folder, true});
+		}
+
+		return entries;
+	}
+
+	bool is_inside_folder(const std::filesystem::path& file, const std::filesystem::path& folder)
+	{
+		const auto relative = std::filesystem::relative(file, folder);
+		const auto start = relative.begin();
+		return start != relative.end() && start->string() != "..";
+	}
+}
+
+// Classifying the data folder during cleanup: the original nested loop over all manifest paths,
+// the binary manifest lookups that replaced it, and the case-folded path table used now
+BENCHMARK(cleanup_classification)
+{
+	const auto base = std::filesystem::temp_directory_path() / "xlabs-benchmarks" / "cleanup" / "data";
+	const auto names = generate_names();
+	const auto entries = generate_entries(base, names);
+
+	std::vector<updater::file_info> files{};
+	for (const auto& name : names)
+	{
+		files.push_back({name, 0, "0000000000000000000000000000000000000000"});
+	}
+
+	const updater::binary_manifest manifest(updater::binary_manifest::build(files, 0));
+
+	std::printf("  %zu manifest files, %zu entries on disk\n", names.size(), entries.size());
+
+	const auto count_kept = [&entries](const auto& is_kept, const size_t step)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < entries.size(); i += step)
+		{
+			kept += is_kept(entries[i]);
+		}
+
+		benchmarks::sink = benchmarks::sink + kept;
+	};
+
+	std::vector<std::filesystem::path> legal_files{};
+	const auto build_legal_files = benchmarks::measure([&]
+	{
+		legal_files.clear();
+		legal_files.reserve(names.size() * 3);
+		for (const auto& name : names)
+		{
+			const auto target = std::filesystem::absolute(base / name);
+			legal_files.emplace_back(target);
+			legal_files.emplace_back(std::filesystem::path(target) += ".part");
+			legal_files.emplace_back(std::filesystem::path(target) += ".part.state");
+		}
+	});
+
+	const auto sample_step = entries.size() / nested_loop_sample;
+	const auto nested_loop = benchmarks::measure([&]
+	{
+		count_kept([&](const disk_entry& entry)
+		{
+			return std::ranges::any_of(legal_files, [&](const std::filesystem::path& legal_file)
+			{
+				return entry.is_directory ? is_inside_folder(legal_file, entry.path) : legal_file == entry.path;
+			});
+		}, sample_step);
+	}, std::chrono::milliseconds(0));
+
+	benchmarks::report("nested loop, estimated from a sample", (build_legal_files + nested_loop * static_cast<double>(sample_step)) * 1000, "ms");
+
+	benchmarks::report("binary manifest lookups", benchmarks::measure([&]
+	{
+		count_kept([&](const disk_entry& entry)
+		{
+			const auto name = entry.path.lexically_relative(base).generic_string();
+			return entry.is_directory ? manifest.has_prefix(name + "/") : manifest.find(name).has_value();
+		}, 1);
+	}) * 1000, "ms");
+
+	const auto build_table = [&manifest]()
+	{
+		updater::data_path_table table{};
+		table.reserve(manifest.size());
+		for (size_t i = 0; i < manifest.size(); ++i)
+		{
+			table.add_file(manifest.get_entry(i).name);
+		}
+
+		return table;
+	};
+
+	const auto classify = [&](const updater::data_path_table& table)
+	{
+		count_kept([&](const disk_entry& entry)
+		{
+			const auto type = table.get_type(entry.path.lexically_relative(base).generic_string());
+			return type == (entry.is_directory ? updater::data_path_table::entry_type::folder : updater::data_path_table::entry_type::file);
+		}, 1);
+	};
+
+	benchmarks::report("path table, including building it", benchmarks::measure([&]
+	{
+		classify(build_table());
+	}) * 1000, "ms");
+
+	const auto table = build_table();
+	benchmarks::report("path table, lookups only", benchmarks::measure([&]
+	{
+		classify(table);
+	}) * 1000, "ms");
+}
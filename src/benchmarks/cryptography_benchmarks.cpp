@@ -0,0 +1,75 @@
+#include "benchmark.hpp"
+
+#include <utils/cryptography.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	std::string get_random_data(const size_t size, uint32_t seed)
+	{
+		std::string data(size, 0);
+		for (auto& value : data)
+		{
+			seed = seed * 1664525 + 1013904223;
+			value = static_cast<char>(seed >> 24);
+		}
+
+		return data;
+	}
+
+	double get_megabytes_per_second(const size_t bytes, const double seconds)
+	{
+		return static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds;
+	}
+
+	void measure_sha1(const std::string& workload, const std::vector<std::string_view>& data)
+	{
+		size_t bytes = 0;
+		for (const auto& entry : data)
+		{
+			bytes += entry.size();
+		}
+
+		for (const auto* implementation : utils::cryptography::sha1::get_implementations())
+		{
+			const auto seconds = benchmarks::measure([&]
+			{
+				benchmarks::sink = benchmarks::sink + utils::cryptography::sha1::compute_many_with(implementation, data).size();
+			});
+
+			benchmarks::report(workload + ", " + implementation, get_megabytes_per_second(bytes, seconds), "MB/s");
+		}
+
+		const auto seconds = benchmarks::measure([&]
+		{
+			benchmarks::sink = benchmarks::sink + utils::cryptography::sha1::compute_many(data).size();
+		});
+
+		benchmarks::report(workload + ", compute_many", get_megabytes_per_second(bytes, seconds), "MB/s");
+	}
+}
+
+// Single core throughput of every SHA-1 implementation this CPU supports
+BENCHMARK(sha1_throughput)
+{
+	const auto large = get_random_data(64 * 1024 * 1024, 1);
+	measure_sha1("one 64 MB buffer", {large});
+
+	std::vector<std::string> files{};
+	for (uint32_t i = 0; i < 2048; ++i)
+	{
+		files.emplace_back(get_random_data(4 * 1024 + (i * 977) % (28 * 1024), i));
+	}
+
+	measure_sha1("2048 files of 4-32 KB", {files.begin(), files.end()});
+
+	std::vector<std::string> chunks{};
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		chunks.emplace_back(get_random_data(64 * 1024, i));
+	}
+
+	measure_sha1("256 chunks of 64 KB", {chunks.begin(), chunks.end()});
+}
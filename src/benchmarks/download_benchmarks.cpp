@@ -0,0 +1,125 @@
+#include "benchmark.hpp"
+
+#include <utils/cryptography.hpp>
+#include <utils/io.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	// curl hands the body over in pieces of at most CURL_MAX_WRITE_SIZE
+	constexpr size_t piece_size = 16 * 1024;
+
+	std::string get_random_data(const size_t size, uint32_t seed)
+	{
+		std::string data(size, 0);
+		for (auto& value : data)
+		{
+			seed = seed * 1664525 + 1013904223;
+			value = static_cast<char>(seed >> 24);
+		}
+
+		return data;
+	}
+
+	// Feeds the data in pieces as a transfer would, then returns the time from the last piece until the file is committed
+	template <typename Write, typename Commit>
+	double measure_commit_latency(const std::string& data, Write&& write, Commit&& commit)
+	{
+		for (size_t offset = 0; offset < data.size(); offset += piece_size)
+		{
+			write(std::string_view(data).substr(offset, piece_size));
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		commit();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	template <typename Run>
+	double get_mean_latency(Run&& run)
+	{
+		constexpr auto runs = 8;
+
+		run();
+
+		double total = 0;
+		for (auto i = 0; i < runs; ++i)
+		{
+			total += run();
+		}
+
+		return total / runs;
+	}
+}
+
+// Time from the last received byte of a download until its file is committed
+BENCHMARK(download_commit_latency)
+{
+	const auto folder = std::filesystem::temp_directory_path() / "xlabs-benchmarks";
+	std::filesystem::create_directories(folder);
+
+	const auto target = folder / "download.bin";
+
+	for (const size_t size : {1 << 20, 16 << 20, 128 << 20})
+	{
+		const auto data = get_random_data(size, 1);
+		const auto label = std::to_string(size >> 20) + " MB, ";
+
+		// The body is collected in memory, then hashed and written out
+		const auto buffered = get_mean_latency([&]
+		{
+			std::string body{};
+			return measure_commit_latency(data, [&](const std::string_view piece)
+			{
+				body.append(piece);
+			}, [&]
+			{
+				benchmarks::sink = benchmarks::sink + utils::cryptography::sha1::compute(body, true).size();
+				utils::io::write_file(target.wstring(), body, false);
+			});
+		});
+
+		// Hashed while it arrives, the body is still written out at the end
+		const auto hashed = get_mean_latency([&]
+		{
+			std::string body{};
+			utils::cryptography::sha1::context hash{};
+
+			return measure_commit_latency(data, [&](const std::string_view piece)
+			{
+				body.append(piece);
+				hash.update(reinterpret_cast<const uint8_t*>(piece.data()), piece.size());
+			}, [&]
+			{
+				benchmarks::sink = benchmarks::sink + hash.finalize(true).size();
+				utils::io::write_file(target.wstring(), body, false);
+			});
+		});
+
+		// Hashed and streamed into the temporary file while it arrives, the commit flushes and renames it
+		const auto streamed = get_mean_latency([&]
+		{
+			utils::io::atomic_file file{target};
+			utils::cryptography::sha1::context hash{};
+
+			return measure_commit_latency(data, [&](const std::string_view piece)
+			{
+				file.write(piece.data(), piece.size());
+				hash.update(reinterpret_cast<const uint8_t*>(piece.data()), piece.size());
+			}, [&]
+			{
+				benchmarks::sink = benchmarks::sink + hash.finalize(true).size();
+				file.commit();
+			});
+		});
+
+		benchmarks::report(label + "buffer, then hash and write", buffered, "ms");
+		benchmarks::report(label + "hash while receiving, then write", hashed, "ms");
+		benchmarks::report(label + "hash and stream while receiving", streamed, "ms");
+	}
+
+	std::error_code code{};
+	std::filesystem::remove_all(folder, code);
+}
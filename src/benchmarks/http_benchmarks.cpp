@@ -0,0 +1,96 @@
+#include "benchmark.hpp"
+
+#include <utils/http.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr size_t request_count = 512;
+
+	// Fetches every URL with as many workers as the engine allows transfers, like update_files does
+	size_t fetch_all(const std::vector<std::string>& urls)
+	{
+		std::atomic<size_t> next_index{0};
+		std::atomic<size_t> failures{0};
+
+		std::vector<std::thread> workers{};
+		for (size_t i = 0; i < utils::http::get_max_concurrent_transfers(); ++i)
+		{
+			workers.emplace_back([&]
+			{
+				for (auto index = next_index++; index < urls.size(); index = next_index++)
+				{
+					if (!utils::http::get_data(urls[index]))
+					{
+						++failures;
+					}
+				}
+			});
+		}
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		return failures;
+	}
+}
+
+// Requests per second for small files from a local server. XLABS_BENCHMARK_URL is the base URL of the server
+// and XLABS_BENCHMARK_ROOT the folder it serves, the files are written there first. Whether HTTP/2 or HTTP/1.1
+// is measured depends on what the server offers through ALPN.
+BENCHMARK(http_requests_per_second)
+{
+	const auto* base_url = std::getenv("XLABS_BENCHMARK_URL");
+	const auto* root = std::getenv("XLABS_BENCHMARK_ROOT");
+	if (!base_url || !root)
+	{
+		std::printf("  skipped, XLABS_BENCHMARK_URL and XLABS_BENCHMARK_ROOT are not set\n");
+		return;
+	}
+
+	std::printf("  %s, curl %s HTTP/2, up to %zu transfers\n", base_url, utils::http::supports_http2() ? "with" : "without",
+	            utils::http::get_max_concurrent_transfers());
+
+	for (const size_t size : {1024, 4 * 1024, 16 * 1024, 64 * 1024})
+	{
+		const auto folder = "xlabs-benchmark/" + std::to_string(size / 1024) + "k/";
+		std::filesystem::create_directories(std::filesystem::path(root) / folder);
+
+		const std::string data(size, 'x');
+		std::vector<std::string> urls{};
+
+		for (size_t i = 0; i < request_count; ++i)
+		{
+			const auto name = folder + std::to_string(i) + ".bin";
+			std::ofstream(std::filesystem::path(root) / name, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+			urls.emplace_back(base_url + name);
+		}
+
+		size_t failures = 0;
+		const auto seconds = benchmarks::measure([&]
+		{
+			failures += fetch_all(urls);
+		}, std::chrono::milliseconds(2000));
+
+		if (failures)
+		{
+			throw std::runtime_error(std::to_string(failures) + " requests failed");
+		}
+
+		benchmarks::report(std::to_string(request_count) + " files of " + std::to_string(size / 1024) + " KB",
+		                   static_cast<double>(request_count) / seconds, "requests/s");
+	}
+
+	std::error_code code{};
+	std::filesystem::remove_all(std::filesystem::path(root) / "xlabs-benchmark", code);
+}
@@ -0,0 +1,65 @@
+#include "benchmark.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+namespace benchmarks
+{
+	namespace
+	{
+		struct benchmark
+		{
+			const char* name;
+			benchmark_function function;
+		};
+
+		// Benchmarks register themselves during static initialization, so the list has to exist before the first one
+		std::vector<benchmark>& get_benchmarks()
+		{
+			static std::vector<benchmark> list{};
+			return list;
+		}
+	}
+
+	bool register_benchmark(const char* name, const benchmark_function function)
+	{
+		get_benchmarks().push_back({name, function});
+		return true;
+	}
+
+	void report(const std::string& label, const double value, const char* unit)
+	{
+		std::printf("  %-48s %12.2f %s\n", label.data(), value, unit);
+	}
+}
+
+// Runs every benchmark, or only those whose name contains the first argument
+int main(const int argc, char** argv)
+{
+	const auto* filter = argc > 1 ? argv[1] : "";
+	auto result = 0;
+
+	for (const auto& benchmark : benchmarks::get_benchmarks())
+	{
+		if (!std::strstr(benchmark.name, filter))
+		{
+			continue;
+		}
+
+		std::printf("%s\n", benchmark.name);
+
+		try
+		{
+			benchmark.function();
+		}
+		catch (const std::exception& e)
+		{
+			std::fprintf(stderr, "%s failed: %s\n", benchmark.name, e.what());
+			result = 1;
+		}
+	}
+
+	return result;
+}
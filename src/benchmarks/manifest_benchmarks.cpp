@@ -0,0 +1,152 @@
+#include "benchmark.hpp"
+
+#include <std_include.hpp>
+
+#include <updater/binary_manifest.hpp>
+#include <updater/manifest_parser.hpp>
+
+#include <utils/io.hpp>
+
+#include <cstdio>
+
+namespace
+{
+	constexpr size_t entry_count = 100'000;
+
+	std::vector<updater::file_info> generate_files()
+	{
+		std::vector<updater::file_info> files{};
+		files.reserve(entry_count);
+
+		std::uint32_t seed = 1;
+		for (size_t i = 0; i < entry_count; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+
+			char hash[41]{};
+			std::snprintf(hash, sizeof(hash), "%08X%08X%08X%08X%08X", seed, seed ^ 0x5A5A5A5A, seed * 3, seed * 5, seed * 7);
+
+			auto name = "data/zone/folder" + std::to_string(i % 97) + "/file" + std::to_string(i) + ".ff";
+			files.push_back({std::move(name), seed % (64 * 1024 * 1024), hash});
+		}
+
+		return files;
+	}
+
+	// Same layout as files.json: an array of [name, size, hash] entries
+	std::string generate_json(const std::vector<updater::file_info>& files)
+	{
+		std::string json = "[";
+		for (const auto& file : files)
+		{
+			json += json.size() > 1 ? ",[\"" : "[\"";
+			json += file.name + "\"," + std::to_string(file.size) + ",\"" + file.hash + "\"]";
+		}
+
+		return json + "]";
+	}
+
+	std::filesystem::path get_binary_path()
+	{
+		const auto folder = std::filesystem::temp_directory_path() / "xlabs-benchmarks" / "manifest";
+		std::filesystem::create_directories(folder);
+		return folder / "manifest-cache.bin";
+	}
+}
+
+// Loading an unchanged manifest: the launcher used to stream files.json through the parser,
+// now it maps the binary copy and reads the entries from it
+BENCHMARK(manifest_load)
+{
+	const auto files = generate_files();
+	const auto json = generate_json(files);
+	const auto binary = updater::binary_manifest::build(files, json.size());
+
+	const auto path = get_binary_path();
+	utils::io::write_file(path.wstring(), binary);
+
+	std::printf("  %zu entries, %zu KB JSON, %zu KB binary\n", files.size(), json.size() / 1024, binary.size() / 1024);
+
+	benchmarks::report("parse JSON", benchmarks::measure([&]
+	{
+		size_t count = 0;
+		updater::manifest_parser parser([&count](updater::file_info&&)
+		{
+			++count;
+		});
+
+		parser.write(json);
+		if (!parser.finish())
+		{
+			throw std::runtime_error("Failed to parse the manifest");
+		}
+
+		benchmarks::sink = benchmarks::sink + count;
+	}) * 1000, "ms");
+
+	benchmarks::report("map binary", benchmarks::measure([&]
+	{
+		const updater::binary_manifest manifest(path);
+		if (!manifest)
+		{
+			throw std::runtime_error("Failed to load the binary manifest");
+		}
+
+		benchmarks::sink = benchmarks::sink + manifest.size();
+	}) * 1000, "ms");
+
+	benchmarks::report("map binary and read all entries", benchmarks::measure([&]
+	{
+		const updater::binary_manifest manifest(path);
+		for (size_t i = 0; i < manifest.size(); ++i)
+		{
+			benchmarks::sink = benchmarks::sink + manifest.get_file_info(i).size;
+		}
+	}) * 1000, "ms");
+
+	std::error_code code{};
+	std::filesystem::remove(path, code);
+}
+
+// Name lookups against the loaded binary manifest, compared with the vector of entries the launcher kept before
+BENCHMARK(manifest_lookup)
+{
+	const auto files = generate_files();
+	const updater::binary_manifest manifest(updater::binary_manifest::build(files, 0));
+
+	std::vector<std::string> names{};
+	for (size_t i = 0; i < files.size(); i += 97)
+	{
+		names.emplace_back(files[i].name);
+	}
+
+	const auto per_lookup = [&names](const double seconds)
+	{
+		return seconds * 1e9 / static_cast<double>(names.size());
+	};
+
+	benchmarks::report("binary find", per_lookup(benchmarks::measure([&]
+	{
+		for (const auto& name : names)
+		{
+			benchmarks::sink = benchmarks::sink + manifest.find(name).value_or(0);
+		}
+	})), "ns/lookup");
+
+	benchmarks::report("binary has_prefix", per_lookup(benchmarks::measure([&]
+	{
+		for (const auto& name : names)
+		{
+			benchmarks::sink = benchmarks::sink + manifest.has_prefix(std::string_view(name).substr(0, name.rfind('/') + 1));
+		}
+	})), "ns/lookup");
+
+	benchmarks::report("linear search of file_info vector", per_lookup(benchmarks::measure([&]
+	{
+		for (const auto& name : names)
+		{
+			const auto entry = std::ranges::find(files, name, &updater::file_info::name);
+			benchmarks::sink = benchmarks::sink + static_cast<size_t>(entry - files.begin());
+		}
+	})), "ns/lookup");
+}
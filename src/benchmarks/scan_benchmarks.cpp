@@ -0,0 +1,114 @@
+#include "benchmark.hpp"
+
+#include <utils/cryptography.hpp>
+#include <utils/io.hpp>
+#include <utils/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// Size of the generated tree, XLABS_BENCHMARK_SCAN_MB overrides it
+	size_t get_tree_size()
+	{
+		const auto* value = std::getenv("XLABS_BENCHMARK_SCAN_MB");
+		const auto megabytes = value ? std::strtoull(value, nullptr, 10) : 2048;
+		return static_cast<size_t>(std::max(megabytes, 1ull)) * 1024 * 1024;
+	}
+
+	// Mostly small files with a few large archives in between, like the game data
+	std::vector<std::filesystem::path> generate_tree(const std::filesystem::path& folder, const size_t total_size)
+	{
+		std::vector<std::filesystem::path> files{};
+		std::string data{};
+
+		uint32_t seed = 1;
+		size_t size = 0;
+
+		while (size < total_size)
+		{
+			seed = seed * 1664525 + 1013904223;
+			const auto file_size = files.size() % 16 == 15 ? (8 + seed % 56) << 20 : (64 + seed % 960) << 10;
+
+			data.resize(file_size);
+			for (auto& value : data)
+			{
+				seed = seed * 1664525 + 1013904223;
+				value = static_cast<char>(seed >> 24);
+			}
+
+			const auto file = folder / std::to_string(files.size() % 32) / (std::to_string(files.size()) + ".bin");
+			std::filesystem::create_directories(file.parent_path());
+			std::ofstream(file, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+
+			files.emplace_back(file);
+			size += file_size;
+		}
+
+		return files;
+	}
+
+	// Same read and hash as the updater does for every file of matching size
+	std::string get_file_hash(const std::filesystem::path& file)
+	{
+		utils::io::mapped_file mapped_file{file};
+		utils::cryptography::sha1::context context{};
+
+		mapped_file.for_each_window([&context](const std::string_view data)
+		{
+			context.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+		});
+
+		return context.finalize(true);
+	}
+}
+
+// Throughput of the outdated file scan over a generated tree, by the number of threads hashing files.
+// The tree is read once before measuring, so this shows how hashing scales, not how the drive does.
+BENCHMARK(outdated_scan_scaling)
+{
+	const auto folder = std::filesystem::temp_directory_path() / "xlabs-benchmarks" / "scan";
+	std::error_code code{};
+	std::filesystem::remove_all(folder, code);
+
+	const auto files = generate_tree(folder, get_tree_size());
+
+	size_t total_size = 0;
+	for (const auto& file : files)
+	{
+		total_size += static_cast<size_t>(std::filesystem::file_size(file));
+	}
+
+	const auto max_threads = utils::thread_pool::get().get_thread_count() + 1;
+	std::vector<size_t> thread_counts{};
+	for (size_t count = 1; count < max_threads; count *= 2)
+	{
+		thread_counts.push_back(count);
+	}
+
+	thread_counts.push_back(max_threads);
+
+	for (const auto thread_count : thread_counts)
+	{
+		const auto seconds = benchmarks::measure([&]
+		{
+			std::vector<std::string> hashes(files.size());
+			utils::thread_pool::get().parallel_for(files.size(), [&](const size_t index)
+			{
+				hashes[index] = get_file_hash(files[index]);
+			}, thread_count);
+
+			benchmarks::sink = benchmarks::sink + hashes.size();
+		});
+
+		const auto label = std::to_string(files.size()) + " files, " + std::to_string(total_size >> 20) + " MB, "
+			+ std::to_string(thread_count) + " threads";
+		benchmarks::report(label, static_cast<double>(total_size) / (1024.0 * 1024.0) / seconds, "MB/s");
+	}
+
+	std::filesystem::remove_all(folder, code);
+}
@@ -0,0 +1,241 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+// Mirrors the constants of the file updater, the simulation should split files the way it does
+#define SEGMENTED_DOWNLOAD_MIN_SIZE (32 * 1024 * 1024)
+#define SEGMENTED_DOWNLOAD_MAX_CONNECTIONS 8
+#define SEGMENT_MIN_SIZE (4 * 1024 * 1024)
+
+namespace
+{
+	struct network
+	{
+		size_t workers;
+		double connection_bandwidth;
+		double link_bandwidth;
+		double request_latency;
+	};
+
+	struct transfer
+	{
+		double remaining;
+		size_t connections;
+		bool segmented;
+	};
+
+	struct worker
+	{
+		double setup_left{};
+		size_t transfer = std::numeric_limits<size_t>::max();
+	};
+
+	constexpr auto no_transfer = std::numeric_limits<size_t>::max();
+
+	// Fluid model of the update pipeline: every worker downloads one file at a time from the queue, a request costs one
+	// round of latency before data flows, and all connections share the link. Once the queue is empty, idle workers
+	// join the large download with the most bytes left per connection, like help_segmented_download does.
+	double simulate(const std::vector<std::uint64_t>& sizes, const network& net, const bool helpers)
+	{
+		std::vector<transfer> transfers{};
+		std::vector<worker> workers(std::max(static_cast<size_t>(1), std::min(net.workers, sizes.size())));
+
+		size_t next_file = 0;
+		double time = 0.0;
+
+		while (true)
+		{
+			for (auto& current : workers)
+			{
+				if (current.transfer != no_transfer)
+				{
+					continue;
+				}
+
+				if (next_file < sizes.size())
+				{
+					const auto size = static_cast<double>(sizes[next_file++]);
+					transfers.push_back({size, 1, size >= SEGMENTED_DOWNLOAD_MIN_SIZE});
+					current = {net.request_latency, transfers.size() - 1};
+					continue;
+				}
+
+				auto best = no_transfer;
+				for (size_t i = 0; helpers && i < transfers.size(); ++i)
+				{
+					const auto& candidate = transfers[i];
+					const auto connections = static_cast<double>(candidate.connections + 1);
+					if (candidate.segmented && candidate.remaining > 0.0 && candidate.connections < SEGMENTED_DOWNLOAD_MAX_CONNECTIONS
+						&& candidate.remaining / connections >= SEGMENT_MIN_SIZE
+						&& (best == no_transfer || candidate.remaining / connections > transfers[best].remaining / static_cast<double>(transfers[best].connections + 1)))
+					{
+						best = i;
+					}
+				}
+
+				if (best != no_transfer)
+				{
+					++transfers[best].connections;
+					current = {net.request_latency, best};
+				}
+			}
+
+			size_t connections = 0;
+			bool busy = false;
+			for (const auto& current : workers)
+			{
+				busy |= current.transfer != no_transfer;
+				connections += current.transfer != no_transfer && current.setup_left <= 0.0;
+			}
+
+			if (!busy)
+			{
+				return time;
+			}
+
+			const auto rate = connections ? std::min(net.connection_bandwidth, net.link_bandwidth / static_cast<double>(connections)) : 0.0;
+
+			std::vector<size_t> flowing(transfers.size());
+			for (const auto& current : workers)
+			{
+				if (current.transfer != no_transfer && current.setup_left <= 0.0)
+				{
+					++flowing[current.transfer];
+				}
+			}
+
+			auto step = std::numeric_limits<double>::infinity();
+			for (const auto& current : workers)
+			{
+				if (current.transfer != no_transfer && current.setup_left > 0.0)
+				{
+					step = std::min(step, current.setup_left);
+				}
+			}
+
+			for (size_t i = 0; i < transfers.size(); ++i)
+			{
+				if (flowing[i])
+				{
+					step = std::min(step, transfers[i].remaining / (rate * static_cast<double>(flowing[i])));
+				}
+			}
+
+			time += step;
+
+			for (size_t i = 0; i < transfers.size(); ++i)
+			{
+				if (flowing[i])
+				{
+					transfers[i].remaining = std::max(0.0, transfers[i].remaining - rate * static_cast<double>(flowing[i]) * step);
+				}
+			}
+
+			for (auto& current : workers)
+			{
+				if (current.transfer == no_transfer)
+				{
+					continue;
+				}
+
+				// Helpers still waiting for their first byte are released along with the finished file
+				if (transfers[current.transfer].remaining <= 1e-6)
+				{
+					current = {};
+				}
+				else if (current.setup_left > 0.0)
+				{
+					current.setup_left = std::max(0.0, current.setup_left - step);
+				}
+			}
+		}
+	}
+
+	// Same order as file_updater::update_files
+	std::vector<std::uint64_t> largest_first(std::vector<std::uint64_t> sizes)
+	{
+		std::ranges::stable_sort(sizes, std::greater{});
+		return sizes;
+	}
+
+	// A few large archives and fastfiles between many small raw files, scattered like names in a sorted manifest
+	std::vector<std::uint64_t> generate_manifest(const size_t count, std::uint32_t seed)
+	{
+		const auto next = [&seed]()
+		{
+			seed = seed * 1664525 + 1013904223;
+			return static_cast<double>(seed >> 8) / static_cast<double>(1 << 24);
+		};
+
+		std::vector<std::uint64_t> sizes{};
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto kind = next();
+			double min_size = 1024.0, max_size = 1024.0 * 1024;
+			if (kind > 0.985)
+			{
+				min_size = 100.0 * 1024 * 1024, max_size = 1536.0 * 1024 * 1024;
+			}
+			else if (kind > 0.85)
+			{
+				min_size = 1024.0 * 1024, max_size = 32.0 * 1024 * 1024;
+			}
+
+			sizes.push_back(static_cast<std::uint64_t>(min_size * std::pow(max_size / min_size, next())));
+		}
+
+		return sizes;
+	}
+
+	void report_orders(const char* name, const std::vector<std::uint64_t>& sizes, const network& net)
+	{
+		std::uint64_t total = 0;
+		for (const auto size : sizes)
+		{
+			total += size;
+		}
+
+		const auto sorted = largest_first(sizes);
+
+		std::printf("  %s: %zu files, %.0f MB\n", name, sizes.size(), static_cast<double>(total) / (1024 * 1024));
+		benchmarks::report("manifest order", simulate(sizes, net, true), "s");
+		benchmarks::report("largest first", simulate(sorted, net, true), "s");
+		benchmarks::report("manifest order, no segment helpers", simulate(sizes, net, false), "s");
+		benchmarks::report("largest first, no segment helpers", simulate(sorted, net, false), "s");
+		benchmarks::report("link limit", static_cast<double>(total) / net.link_bandwidth, "s");
+	}
+}
+
+// Simulated makespan of an update in manifest order and largest file first. Simulated rather than downloaded,
+// so the result only depends on the sizes and the network model, not on the machine running it.
+BENCHMARK(update_schedule_makespan)
+{
+	constexpr auto mb = 1024.0 * 1024.0;
+
+	for (const auto& net : {network{16, 4 * mb, 40 * mb, 0.05}, network{16, 10 * mb, 100 * mb, 0.03}, network{16, 2 * mb, 1000 * mb, 0.05}})
+	{
+		std::printf("  %zu workers, %.0f MB/s per connection, %.0f MB/s link, %.0f ms per request\n", net.workers,
+		            net.connection_bandwidth / mb, net.link_bandwidth / mb, net.request_latency * 1000);
+
+		const auto install = generate_manifest(1200, 1);
+		report_orders("full install", install, net);
+
+		std::vector<std::uint64_t> update{};
+		for (size_t i = 0; i < install.size(); i += 6)
+		{
+			update.push_back(install[i]);
+		}
+
+		report_orders("partial update", update, net);
+
+		// The worst case for manifest order: the largest file comes last
+		auto last = update;
+		std::ranges::sort(last);
+		report_orders("largest file last", last, net);
+	}
+}
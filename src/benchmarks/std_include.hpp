@@ -0,0 +1,33 @@
+#pragma once
+
+// Stands in for the launcher's precompiled header when its sources are built into the benchmarks, without CEF
+
+#define _HAS_CXX20 1
+#define _HAS_CXX17 1
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <set>
+#include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+
+#include <optional>
+
+#include <gsl/gsl>
+
+using namespace std::literals;
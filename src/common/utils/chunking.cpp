@@ -0,0 +1,72 @@
+#include "chunking.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace utils::chunking
+{
+	namespace
+	{
+		constexpr auto gear_table = []()
+		{
+			std::array<uint64_t, 256> table{};
+
+			uint64_t state = 0;
+			for (auto& value : table)
+			{
+				state += 0x9E3779B97F4A7C15;
+
+				auto z = state;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+				value = z ^ (z >> 31);
+			}
+
+			return table;
+		}();
+
+		size_t find_boundary(const std::string_view data, const parameters& params)
+		{
+			if (data.size() <= params.min_size)
+			{
+				return data.size();
+			}
+
+			// The upper bits of the gear hash depend on the last 64 bytes, the lower ones only on the last few
+			const auto bits = std::countr_zero(std::bit_floor(std::max(params.average_size, static_cast<size_t>(2))));
+			const auto mask = ~uint64_t(0) << (64 - bits);
+
+			const auto end = std::min(data.size(), params.max_size);
+
+			uint64_t hash = 0;
+			for (auto i = params.min_size; i < end; ++i)
+			{
+				hash = (hash << 1) + gear_table[static_cast<uint8_t>(data[i])];
+				if ((hash & mask) == 0)
+				{
+					return i + 1;
+				}
+			}
+
+			return end;
+		}
+	}
+
+	void split(std::string_view data, const parameters& params, const std::function<void(std::string_view)>& callback)
+	{
+		while (!data.empty())
+		{
+			const auto length = find_boundary(data, params);
+			if (length == 0)
+			{
+				throw std::invalid_argument("Chunking parameters don't allow any chunk");
+			}
+
+			callback(data.substr(0, length));
+			data.remove_prefix(length);
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <functional>
+#include <string_view>
+
+namespace utils::chunking
+{
+	struct parameters
+	{
+		size_t min_size = 16 * 1024;
+		size_t average_size = 64 * 1024;
+		size_t max_size = 256 * 1024;
+	};
+
+	// Splits the data into content-defined chunks using a gear rolling hash, so insertions
+	// only change the chunks around them. The gear table is derived from splitmix64 with seed 0,
+	// the publishing side has to use the same table and parameters.
+	void split(std::string_view data, const parameters& params, const std::function<void(std::string_view)>& callback);
+}
@@ -4,6 +4,11 @@
 #include <ShlObj.h>
 #include <atlbase.h>
 
+#include <array>
+#include <bit>
+#include <cstring>
+#include <vector>
+
 // CoInitialize is called already in com.cpp
 namespace utils::compression
 {
@@ -65,4 +70,699 @@ namespace utils::compression
 			throw std::runtime_error("Failed to copy files");
 		}
 	}
+
+	namespace
+	{
+		// Thrown when a block or header continues past the buffered input, decoding restarts once more data arrived
+		struct need_input
+		{
+		};
+
+		constexpr size_t window_size = 32 * 1024;
+
+		// Slicing-by-8, table n advances the crc of a byte by n more zero bytes, so eight bytes take one step
+		constexpr std::array<std::array<uint32_t, 256>, 8> crc_tables = []()
+		{
+			std::array<std::array<uint32_t, 256>, 8> tables{};
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				auto value = i;
+				for (auto j = 0; j < 8; ++j)
+				{
+					value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+				}
+
+				tables[0][i] = value;
+			}
+
+			for (size_t table = 1; table < tables.size(); ++table)
+			{
+				for (size_t i = 0; i < 256; ++i)
+				{
+					const auto previous = tables[table - 1][i];
+					tables[table][i] = tables[0][previous & 0xFF] ^ (previous >> 8);
+				}
+			}
+
+			return tables;
+		}();
+
+		uint32_t update_crc(uint32_t crc, std::string_view data)
+		{
+			crc = ~crc;
+
+			while (data.size() >= 8)
+			{
+				uint32_t low{};
+				uint32_t high{};
+				std::memcpy(&low, data.data(), sizeof(low));
+				std::memcpy(&high, data.data() + 4, sizeof(high));
+				low ^= crc;
+
+				crc = crc_tables[7][low & 0xFF] ^ crc_tables[6][(low >> 8) & 0xFF] ^ crc_tables[5][(low >> 16) & 0xFF]
+					^ crc_tables[4][low >> 24] ^ crc_tables[3][high & 0xFF] ^ crc_tables[2][(high >> 8) & 0xFF]
+					^ crc_tables[1][(high >> 16) & 0xFF] ^ crc_tables[0][high >> 24];
+
+				data.remove_prefix(8);
+			}
+
+			for (const auto byte : data)
+			{
+				crc = crc_tables[0][(crc ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (crc >> 8);
+			}
+
+			return ~crc;
+		}
+
+		class bit_reader
+		{
+		public:
+			bit_reader(const std::string_view data, const size_t position, const uint32_t bit_position)
+				: data_(data)
+				, position_(position)
+				, bit_position_(bit_position)
+			{
+			}
+
+			// Returns at least the next 57 bits if the input has them and how many bits are valid, the rest reads as zero
+			[[nodiscard]] std::pair<uint64_t, uint32_t> peek() const
+			{
+				static_assert(std::endian::native == std::endian::little);
+
+				const auto remaining = this->data_.size() - std::min(this->position_, this->data_.size());
+
+				uint64_t value = 0;
+				if (remaining >= sizeof(value))
+				{
+					std::memcpy(&value, this->data_.data() + this->position_, sizeof(value));
+				}
+				else if (remaining > 0)
+				{
+					std::memcpy(&value, this->data_.data() + this->position_, remaining);
+				}
+
+				const auto available = static_cast<uint32_t>(std::min(remaining, sizeof(value)) * 8) - this->bit_position_;
+				return {value >> this->bit_position_, available};
+			}
+
+			void skip(const uint32_t count)
+			{
+				const auto total = this->bit_position_ + count;
+				this->position_ += total >> 3;
+				this->bit_position_ = total & 7;
+			}
+
+			uint32_t bits(const uint32_t count)
+			{
+				if (count == 0)
+				{
+					return 0;
+				}
+
+				const auto [value, available] = this->peek();
+				if (available < count)
+				{
+					throw need_input{};
+				}
+
+				this->skip(count);
+				return static_cast<uint32_t>(value & ((uint64_t(1) << count) - 1));
+			}
+
+			void align()
+			{
+				if (this->bit_position_)
+				{
+					this->bit_position_ = 0;
+					++this->position_;
+				}
+			}
+
+			uint8_t byte()
+			{
+				return static_cast<uint8_t>(this->bits(8));
+			}
+
+			std::string_view bytes(const size_t count)
+			{
+				this->align();
+
+				if (count > this->data_.size() - std::min(this->position_, this->data_.size()))
+				{
+					throw need_input{};
+				}
+
+				const auto result = this->data_.substr(this->position_, count);
+				this->position_ += count;
+				return result;
+			}
+
+			[[nodiscard]] size_t get_position() const
+			{
+				return this->position_;
+			}
+
+			[[nodiscard]] uint32_t get_bit_position() const
+			{
+				return this->bit_position_;
+			}
+
+		private:
+			std::string_view data_{};
+			size_t position_{};
+			uint32_t bit_position_{};
+		};
+
+		constexpr uint32_t max_code_length = 15;
+		constexpr uint32_t root_table_bits = 10;
+
+		// Canonical huffman code, decoded with a table indexed by the next bits of the input.
+		// Entries hold the symbol and its code length, codes longer than the root table continue in a subtable,
+		// which the root entry points to together with the number of bits indexing it. A length of 0 marks unused codes.
+		struct huffman
+		{
+			uint32_t root_bits{};
+			std::vector<uint32_t> table{};
+		};
+
+		constexpr uint32_t make_entry(const uint32_t value, const uint32_t length, const uint32_t subtable_bits)
+		{
+			return value | (length << 16) | (subtable_bits << 24);
+		}
+
+		// Deflate packs codes starting with their most significant bit, so tables are indexed by the reversed code
+		uint32_t reverse_bits(uint32_t value, const uint32_t count)
+		{
+			uint32_t result = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				result = (result << 1) | (value & 1);
+				value >>= 1;
+			}
+
+			return result;
+		}
+
+		void construct(huffman& code, const uint8_t* lengths, const size_t length_count)
+		{
+			std::array<uint16_t, max_code_length + 1> count{};
+			for (size_t i = 0; i < length_count; ++i)
+			{
+				++count[lengths[i]];
+			}
+
+			int left = 1;
+			uint32_t longest = 0;
+			for (uint32_t length = 1; length < count.size(); ++length)
+			{
+				left <<= 1;
+				left -= count[length];
+				if (left < 0)
+				{
+					throw std::runtime_error("Invalid deflate code lengths");
+				}
+
+				if (count[length])
+				{
+					longest = length;
+				}
+			}
+
+			std::array<uint32_t, max_code_length + 1> next_code{};
+			for (uint32_t length = 1, value = 0; length < next_code.size(); ++length)
+			{
+				value = (value + (length > 1 ? count[length - 1] : 0)) << 1;
+				next_code[length] = value;
+			}
+
+			std::array<uint32_t, 288> codes{};
+			for (size_t symbol = 0; symbol < length_count; ++symbol)
+			{
+				if (lengths[symbol])
+				{
+					codes[symbol] = reverse_bits(next_code[lengths[symbol]]++, lengths[symbol]);
+				}
+			}
+
+			code.root_bits = std::clamp(longest, 1u, root_table_bits);
+			const auto root_mask = (1u << code.root_bits) - 1;
+
+			// Every root entry gets a subtable sized for the longest code sharing its prefix
+			std::vector<uint32_t> subtable_bits(size_t(1) << code.root_bits);
+			for (size_t symbol = 0; symbol < length_count; ++symbol)
+			{
+				if (lengths[symbol] > code.root_bits)
+				{
+					auto& bits = subtable_bits[codes[symbol] & root_mask];
+					bits = std::max(bits, lengths[symbol] - code.root_bits);
+				}
+			}
+
+			code.table.assign(subtable_bits.size(), 0);
+			for (size_t prefix = 0; prefix < subtable_bits.size(); ++prefix)
+			{
+				if (subtable_bits[prefix])
+				{
+					code.table[prefix] = make_entry(static_cast<uint32_t>(code.table.size()), 0, subtable_bits[prefix]);
+					code.table.resize(code.table.size() + (size_t(1) << subtable_bits[prefix]), 0);
+				}
+			}
+
+			for (size_t symbol = 0; symbol < length_count; ++symbol)
+			{
+				const uint32_t length = lengths[symbol];
+				if (!length)
+				{
+					continue;
+				}
+
+				const auto entry = make_entry(static_cast<uint32_t>(symbol), length, 0);
+
+				// Shorter codes fill every index their bits are a prefix of
+				if (length <= code.root_bits)
+				{
+					for (auto index = codes[symbol]; index <= root_mask; index += 1u << length)
+					{
+						code.table[index] = entry;
+					}
+
+					continue;
+				}
+
+				const auto subtable = code.table[codes[symbol] & root_mask];
+				const auto start = subtable & 0xFFFF;
+				const auto size = 1u << (subtable >> 24);
+
+				for (auto index = codes[symbol] >> code.root_bits; index < size; index += 1u << (length - code.root_bits))
+				{
+					code.table[start + index] = entry;
+				}
+			}
+		}
+
+		uint32_t decode_symbol(bit_reader& reader, const huffman& code)
+		{
+			const auto [value, available] = reader.peek();
+
+			auto entry = code.table[static_cast<size_t>(value & ((1u << code.root_bits) - 1))];
+			if (const auto subtable_bits = entry >> 24)
+			{
+				const auto index = static_cast<uint32_t>(value >> code.root_bits) & ((1u << subtable_bits) - 1);
+				entry = code.table[(entry & 0xFFFF) + index];
+			}
+
+			const auto length = (entry >> 16) & 0xFF;
+			if (length == 0 || length > available)
+			{
+				// Missing input reads as zero bits, which can look like an unused code as well
+				if (available < max_code_length)
+				{
+					throw need_input{};
+				}
+
+				throw std::runtime_error("Invalid deflate code");
+			}
+
+			reader.skip(length);
+			return entry & 0xFFFF;
+		}
+
+		constexpr std::array<uint16_t, 29> length_base{3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+		constexpr std::array<uint8_t, 29> length_extra{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+		constexpr std::array<uint16_t, 30> distance_base{1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+		constexpr std::array<uint8_t, 30> distance_extra{0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+		const std::pair<huffman, huffman>& get_fixed_codes()
+		{
+			static const auto codes = []()
+			{
+				std::array<uint8_t, 288> lengths{};
+				std::fill(lengths.begin(), lengths.begin() + 144, static_cast<uint8_t>(8));
+				std::fill(lengths.begin() + 144, lengths.begin() + 256, static_cast<uint8_t>(9));
+				std::fill(lengths.begin() + 256, lengths.begin() + 280, static_cast<uint8_t>(7));
+				std::fill(lengths.begin() + 280, lengths.end(), static_cast<uint8_t>(8));
+
+				std::pair<huffman, huffman> result{};
+				construct(result.first, lengths.data(), lengths.size());
+
+				std::fill(lengths.begin(), lengths.begin() + 30, static_cast<uint8_t>(5));
+				construct(result.second, lengths.data(), 30);
+
+				return result;
+			}();
+
+			return codes;
+		}
+
+		std::pair<huffman, huffman> read_dynamic_codes(bit_reader& reader)
+		{
+			constexpr std::array<uint8_t, 19> order{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+			const auto literal_count = reader.bits(5) + 257;
+			const auto distance_count = reader.bits(5) + 1;
+			const auto code_count = reader.bits(4) + 4;
+
+			if (literal_count > 286 || distance_count > 30)
+			{
+				throw std::runtime_error("Invalid deflate block header");
+			}
+
+			std::array<uint8_t, 320> lengths{};
+			for (uint32_t i = 0; i < code_count; ++i)
+			{
+				lengths[order[i]] = static_cast<uint8_t>(reader.bits(3));
+			}
+
+			huffman length_code{};
+			construct(length_code, lengths.data(), order.size());
+
+			uint32_t index = 0;
+			while (index < literal_count + distance_count)
+			{
+				const auto symbol = decode_symbol(reader, length_code);
+				if (symbol < 16)
+				{
+					lengths[index++] = static_cast<uint8_t>(symbol);
+					continue;
+				}
+
+				uint8_t value = 0;
+				uint32_t repeat{};
+
+				if (symbol == 16)
+				{
+					if (index == 0)
+					{
+						throw std::runtime_error("Invalid deflate code lengths");
+					}
+
+					value = lengths[index - 1];
+					repeat = 3 + reader.bits(2);
+				}
+				else if (symbol == 17)
+				{
+					repeat = 3 + reader.bits(3);
+				}
+				else
+				{
+					repeat = 11 + reader.bits(7);
+				}
+
+				if (index + repeat > literal_count + distance_count)
+				{
+					throw std::runtime_error("Invalid deflate code lengths");
+				}
+
+				while (repeat-- > 0)
+				{
+					lengths[index++] = value;
+				}
+			}
+
+			if (lengths[256] == 0)
+			{
+				throw std::runtime_error("Deflate block has no end code");
+			}
+
+			std::pair<huffman, huffman> result{};
+			construct(result.first, lengths.data(), literal_count);
+			construct(result.second, lengths.data() + literal_count, distance_count);
+
+			return result;
+		}
+
+		void inflate_codes(bit_reader& reader, const huffman& literal_code, const huffman& distance_code,
+		                   const std::string& history, std::string& block)
+		{
+			while (true)
+			{
+				auto symbol = decode_symbol(reader, literal_code);
+				if (symbol < 256)
+				{
+					block.push_back(static_cast<char>(symbol));
+					continue;
+				}
+
+				if (symbol == 256)
+				{
+					return;
+				}
+
+				symbol -= 257;
+				if (symbol >= length_base.size())
+				{
+					throw std::runtime_error("Invalid deflate length");
+				}
+
+				const auto length = length_base[symbol] + reader.bits(length_extra[symbol]);
+
+				const auto distance_symbol = decode_symbol(reader, distance_code);
+				if (distance_symbol >= distance_base.size())
+				{
+					throw std::runtime_error("Invalid deflate distance");
+				}
+
+				const auto distance = distance_base[distance_symbol] + reader.bits(distance_extra[distance_symbol]);
+				if (distance > history.size() + block.size())
+				{
+					throw std::runtime_error("Deflate distance too far back");
+				}
+
+				const auto start = block.size();
+				block.resize(start + length);
+				auto* const output = block.data();
+
+				// The part of the match that lies before this block comes from the history, it can't overlap the output
+				size_t copied = 0;
+				if (distance > start)
+				{
+					copied = std::min(static_cast<size_t>(length), distance - start);
+					std::memcpy(output + start, history.data() + history.size() - (distance - start), copied);
+				}
+
+				// Matches may overlap their own output, so they are copied byte by byte
+				for (auto i = start + copied; i < block.size(); ++i)
+				{
+					output[i] = output[i - distance];
+				}
+			}
+		}
+	}
+
+	gzip_decoder::gzip_decoder(std::function<void(std::string_view)> output)
+		: output_(std::move(output))
+	{
+	}
+
+	void gzip_decoder::write(const char* data, const size_t length)
+	{
+		if (this->done_)
+		{
+			if (length > 0)
+			{
+				throw std::runtime_error("Data after the end of the gzip stream");
+			}
+
+			return;
+		}
+
+		this->input_.append(data, length);
+
+		// Incomplete blocks are decoded again from their start, waiting for more input keeps that rare
+		if (this->input_.size() - this->position_ >= this->next_attempt_)
+		{
+			this->process(false);
+		}
+	}
+
+	void gzip_decoder::finish()
+	{
+		if (!this->done_)
+		{
+			this->process(true);
+		}
+
+		if (!this->done_)
+		{
+			throw std::runtime_error("Incomplete gzip stream");
+		}
+	}
+
+	void gzip_decoder::reset()
+	{
+		this->input_.clear();
+		this->position_ = 0;
+		this->bit_position_ = 0;
+		this->next_attempt_ = 0;
+		this->history_.clear();
+		this->crc_ = 0;
+		this->size_ = 0;
+		this->header_done_ = false;
+		this->blocks_done_ = false;
+		this->done_ = false;
+	}
+
+	bool gzip_decoder::is_done() const
+	{
+		return this->done_;
+	}
+
+	void gzip_decoder::process(const bool final)
+	{
+		try
+		{
+			if (!this->header_done_)
+			{
+				this->parse_header();
+			}
+
+			while (!this->blocks_done_)
+			{
+				this->decode_block();
+			}
+
+			this->parse_trailer();
+			this->next_attempt_ = 0;
+		}
+		catch (const need_input&)
+		{
+			if (final)
+			{
+				throw std::runtime_error("Incomplete gzip stream");
+			}
+
+			this->next_attempt_ = std::max(static_cast<size_t>(64 * 1024), (this->input_.size() - this->position_) * 2);
+		}
+
+		if (this->position_ > 0)
+		{
+			this->input_.erase(0, this->position_);
+			this->position_ = 0;
+		}
+	}
+
+	void gzip_decoder::parse_header()
+	{
+		bit_reader reader{this->input_, this->position_, this->bit_position_};
+
+		const auto magic = reader.bytes(3);
+		if (magic != std::string_view("\x1F\x8B\x08", 3))
+		{
+			throw std::runtime_error("Invalid gzip header");
+		}
+
+		const auto flags = reader.byte();
+		reader.bytes(6);
+
+		if (flags & 4)
+		{
+			const auto low = reader.byte();
+			const auto high = reader.byte();
+			reader.bytes(static_cast<size_t>(low | (high << 8)));
+		}
+
+		for (const auto flag : {8, 16})
+		{
+			if (flags & flag)
+			{
+				while (reader.byte() != 0)
+				{
+				}
+			}
+		}
+
+		if (flags & 2)
+		{
+			reader.bytes(2);
+		}
+
+		this->position_ = reader.get_position();
+		this->bit_position_ = reader.get_bit_position();
+		this->header_done_ = true;
+	}
+
+	void gzip_decoder::decode_block()
+	{
+		bit_reader reader{this->input_, this->position_, this->bit_position_};
+		std::string block{};
+
+		const auto last = reader.bits(1);
+		const auto type = reader.bits(2);
+
+		if (type == 0)
+		{
+			const auto header = reader.bytes(4);
+			const auto length = static_cast<uint8_t>(header[0]) | (static_cast<uint8_t>(header[1]) << 8);
+			const auto complement = static_cast<uint8_t>(header[2]) | (static_cast<uint8_t>(header[3]) << 8);
+			if (length != (~complement & 0xFFFF))
+			{
+				throw std::runtime_error("Invalid stored deflate block");
+			}
+
+			block = reader.bytes(static_cast<size_t>(length));
+		}
+		else if (type == 1)
+		{
+			const auto& codes = get_fixed_codes();
+			inflate_codes(reader, codes.first, codes.second, this->history_, block);
+		}
+		else if (type == 2)
+		{
+			const auto codes = read_dynamic_codes(reader);
+			inflate_codes(reader, codes.first, codes.second, this->history_, block);
+		}
+		else
+		{
+			throw std::runtime_error("Invalid deflate block type");
+		}
+
+		this->position_ = reader.get_position();
+		this->bit_position_ = reader.get_bit_position();
+		this->blocks_done_ = last != 0;
+
+		this->crc_ = update_crc(this->crc_, block);
+		this->size_ += block.size();
+
+		this->history_.append(block);
+		if (this->history_.size() > window_size * 2)
+		{
+			this->history_.erase(0, this->history_.size() - window_size);
+		}
+
+		if (!block.empty())
+		{
+			this->output_(block);
+		}
+	}
+
+	void gzip_decoder::parse_trailer()
+	{
+		bit_reader reader{this->input_, this->position_, this->bit_position_};
+		const auto trailer = reader.bytes(8);
+
+		const auto read_uint32 = [&trailer](const size_t offset)
+		{
+			uint32_t value = 0;
+			for (size_t i = 0; i < 4; ++i)
+			{
+				value |= static_cast<uint32_t>(static_cast<uint8_t>(trailer[offset + i])) << (i * 8);
+			}
+
+			return value;
+		};
+
+		if (read_uint32(0) != this->crc_ || read_uint32(4) != static_cast<uint32_t>(this->size_))
+		{
+			throw std::runtime_error("gzip checksum mismatch");
+		}
+
+		this->position_ = reader.get_position();
+		this->bit_position_ = 0;
+		this->done_ = true;
+
+		if (this->position_ != this->input_.size())
+		{
+			throw std::runtime_error("Data after the end of the gzip stream");
+		}
+	}
 }
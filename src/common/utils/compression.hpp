@@ -1,7 +1,47 @@
 #pragma once
 #include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
 
 namespace utils::compression
 {
 	void decompress(const std::filesystem::path& file, const std::filesystem::path& into);
+
+	// Streaming gzip (RFC 1952) decoder, the input may arrive in pieces of any size
+	// Plain data is passed to the output one deflate block at a time
+	class gzip_decoder
+	{
+	public:
+		gzip_decoder(std::function<void(std::string_view)> output);
+
+		void write(const char* data, size_t length);
+
+		// Decodes what is left and throws if the stream is incomplete
+		void finish();
+		void reset();
+
+		[[nodiscard]] bool is_done() const;
+
+	private:
+		std::function<void(std::string_view)> output_;
+
+		std::string input_{};
+		size_t position_{};
+		uint32_t bit_position_{};
+		size_t next_attempt_{};
+
+		std::string history_{};
+		uint32_t crc_{};
+		uint64_t size_{};
+
+		bool header_done_{};
+		bool blocks_done_{};
+		bool done_{};
+
+		void process(bool final);
+		void parse_header();
+		void decode_block();
+		void parse_trailer();
+	};
 }
@@ -1,86 +1,936 @@
 #include "string.hpp"
 #include "cryptography.hpp"
-#include "nt.hpp"
+#include "thread_pool.hpp"
 
-#include <gsl/gsl>
+#include <bit>
+#include <limits>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
 
-#include <bcrypt.h>
-#pragma comment(lib, "Bcrypt.lib")
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHA1_HAS_SHA_NI
+#define SHA1_HAS_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SHA_NI_TARGET
+#define AVX2_TARGET
+#else
+#include <cpuid.h>
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define SHA1_HAS_ARMV8
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#if defined(_MSC_VER) || defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#define ARMV8_TARGET
+#elif defined(__clang__)
+#define ARMV8_TARGET __attribute__((target("sha2")))
+#else
+#define ARMV8_TARGET __attribute__((target("+crypto")))
+#endif
+#endif
 
 namespace utils::cryptography
 {
 	namespace
 	{
-		std::string compute_hash(const LPCWSTR hash_name, const uint8_t* data, const size_t length, const bool hex)
+		using block_function = sha1::block_function;
+
+		constexpr uint32_t initial_state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+		uint32_t rotate_left(const uint32_t value, const int count)
+		{
+			return (value << count) | (value >> (32 - count));
+		}
+
+		uint32_t load_big_endian(const uint8_t* data)
+		{
+			return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+				| (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+		}
+
+		template <int Round>
+		void scalar_round(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t& e, const uint32_t w)
 		{
-			BCRYPT_ALG_HANDLE algorithm{};
-			if (FAILED(BCryptOpenAlgorithmProvider(&algorithm, hash_name, nullptr, 0)))
+			uint32_t f, k;
+			if constexpr (Round == 0)
+			{
+				f = d ^ (b & (c ^ d));
+				k = 0x5A827999;
+			}
+			else if constexpr (Round == 1)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			}
+			else if constexpr (Round == 2)
 			{
-				return {};
+				f = (b & c) | (d & (b | c));
+				k = 0x8F1BBCDC;
 			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+
+			const auto temp = rotate_left(a, 5) + f + e + k + w;
+			e = d;
+			d = c;
+			c = rotate_left(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		void process_blocks_scalar(uint32_t* state, const uint8_t* data, size_t blocks)
+		{
+			uint32_t w[80];
 
-			auto _ = gsl::finally([&algorithm]()
+			while (blocks--)
 			{
-				BCryptCloseAlgorithmProvider(algorithm, 0);
-			});
+				for (auto i = 0; i < 16; ++i)
+				{
+					w[i] = load_big_endian(data + i * 4);
+				}
 
-			DWORD hash_obj_length{}, data_count{}, hash_data_length{};
-			if (FAILED(BCryptGetProperty(algorithm, BCRYPT_OBJECT_LENGTH,
-				reinterpret_cast<PBYTE>(&hash_obj_length),
-				sizeof(DWORD),
-				&data_count,
-				0)))
+				for (auto i = 16; i < 80; ++i)
+				{
+					w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+				}
+
+				auto a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+				// Separate loops per round function keep the hot loop free of branches
+				for (auto i = 0; i < 20; ++i) scalar_round<0>(a, b, c, d, e, w[i]);
+				for (auto i = 20; i < 40; ++i) scalar_round<1>(a, b, c, d, e, w[i]);
+				for (auto i = 40; i < 60; ++i) scalar_round<2>(a, b, c, d, e, w[i]);
+				for (auto i = 60; i < 80; ++i) scalar_round<3>(a, b, c, d, e, w[i]);
+
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+
+				data += 64;
+			}
+		}
+
+#ifdef SHA1_HAS_SHA_NI
+		bool has_sha_extensions()
+		{
+#ifdef _MSC_VER
+			int info[4]{};
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+
+			__cpuid(info, 1);
+			const auto has_sse41 = (info[2] & (1 << 19)) != 0;
+
+			__cpuidex(info, 7, 0);
+			const auto has_sha = (info[1] & (1 << 29)) != 0;
+#else
+			unsigned int eax{}, ebx{}, ecx{}, edx{};
+			if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
 			{
-				return {};
+				return false;
+			}
+
+			const auto has_sse41 = (ecx & (1 << 19)) != 0;
+
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			const auto has_sha = (ebx & (1 << 29)) != 0;
+#endif
+
+			return has_sse41 && has_sha;
+		}
+
+		// Four rounds per instruction using the Intel SHA extensions
+		SHA_NI_TARGET void process_blocks_sha_ni(uint32_t* state, const uint8_t* data, size_t blocks)
+		{
+			const auto mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+			auto abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+			auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+			abcd = _mm_shuffle_epi32(abcd, 0x1B);
+
+			while (blocks--)
+			{
+				const auto abcd_save = abcd;
+				const auto e_save = e0;
+
+				auto msg0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), mask);
+				auto msg1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), mask);
+				auto msg2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), mask);
+				auto msg3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), mask);
+
+				// Rounds 0-3
+				e0 = _mm_add_epi32(e0, msg0);
+				auto e1 = abcd;
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+				// Rounds 4-7
+				e1 = _mm_sha1nexte_epu32(e1, msg1);
+				e0 = abcd;
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+				msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+				// Rounds 8-11
+				e0 = _mm_sha1nexte_epu32(e0, msg2);
+				e1 = abcd;
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+				msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+				msg0 = _mm_xor_si128(msg0, msg2);
+
+				// Rounds 12-15
+				e1 = _mm_sha1nexte_epu32(e1, msg3);
+				e0 = abcd;
+				msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+				msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+				msg1 = _mm_xor_si128(msg1, msg3);
+
+				// Rounds 16-19
+				e0 = _mm_sha1nexte_epu32(e0, msg0);
+				e1 = abcd;
+				msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+				msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+				msg2 = _mm_xor_si128(msg2, msg0);
+
+				// Rounds 20-23
+				e1 = _mm_sha1nexte_epu32(e1, msg1);
+				e0 = abcd;
+				msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+				msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+				msg3 = _mm_xor_si128(msg3, msg1);
+
+				// Rounds 24-27
+				e0 = _mm_sha1nexte_epu32(e0, msg2);
+				e1 = abcd;
+				msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+				msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+				msg0 = _mm_xor_si128(msg0, msg2);
+
+				// Rounds 28-31
+				e1 = _mm_sha1nexte_epu32(e1, msg3);
+				e0 = abcd;
+				msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+				msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+				msg1 = _mm_xor_si128(msg1, msg3);
+
+				// Rounds 32-35
+				e0 = _mm_sha1nexte_epu32(e0, msg0);
+				e1 = abcd;
+				msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+				msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+				msg2 = _mm_xor_si128(msg2, msg0);
+
+				// Rounds 36-39
+				e1 = _mm_sha1nexte_epu32(e1, msg1);
+				e0 = abcd;
+				msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+				msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+				msg3 = _mm_xor_si128(msg3, msg1);
+
+				// Rounds 40-43
+				e0 = _mm_sha1nexte_epu32(e0, msg2);
+				e1 = abcd;
+				msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+				msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+				msg0 = _mm_xor_si128(msg0, msg2);
+
+				// Rounds 44-47
+				e1 = _mm_sha1nexte_epu32(e1, msg3);
+				e0 = abcd;
+				msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+				msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+				msg1 = _mm_xor_si128(msg1, msg3);
+
+				// Rounds 48-51
+				e0 = _mm_sha1nexte_epu32(e0, msg0);
+				e1 = abcd;
+				msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+				msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+				msg2 = _mm_xor_si128(msg2, msg0);
+
+				// Rounds 52-55
+				e1 = _mm_sha1nexte_epu32(e1, msg1);
+				e0 = abcd;
+				msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+				msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+				msg3 = _mm_xor_si128(msg3, msg1);
+
+				// Rounds 56-59
+				e0 = _mm_sha1nexte_epu32(e0, msg2);
+				e1 = abcd;
+				msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+				msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+				msg0 = _mm_xor_si128(msg0, msg2);
+
+				// Rounds 60-63
+				e1 = _mm_sha1nexte_epu32(e1, msg3);
+				e0 = abcd;
+				msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+				msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+				msg1 = _mm_xor_si128(msg1, msg3);
+
+				// Rounds 64-67
+				e0 = _mm_sha1nexte_epu32(e0, msg0);
+				e1 = abcd;
+				msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+				msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+				msg2 = _mm_xor_si128(msg2, msg0);
+
+				// Rounds 68-71
+				e1 = _mm_sha1nexte_epu32(e1, msg1);
+				e0 = abcd;
+				msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+				msg3 = _mm_xor_si128(msg3, msg1);
+
+				// Rounds 72-75
+				e0 = _mm_sha1nexte_epu32(e0, msg2);
+				e1 = abcd;
+				msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+				// Rounds 76-79
+				e1 = _mm_sha1nexte_epu32(e1, msg3);
+				e0 = abcd;
+				abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+				e0 = _mm_sha1nexte_epu32(e0, e_save);
+				abcd = _mm_add_epi32(abcd, abcd_save);
+
+				data += 64;
 			}
 
+			abcd = _mm_shuffle_epi32(abcd, 0x1B);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(state), abcd);
+			state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+		}
+#endif
+
+#ifdef SHA1_HAS_ARMV8
+		bool has_sha_extensions()
+		{
+#ifdef _WIN32
+			return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != FALSE;
+#elif defined(__linux__)
+			return (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+#elif defined(__APPLE__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		// Four rounds per instruction using the ARMv8 cryptography extension
+		ARMV8_TARGET void process_blocks_armv8(uint32_t* state, const uint8_t* data, size_t blocks)
+		{
+			const uint32x4_t constants[4] = {
+				vdupq_n_u32(0x5A827999), vdupq_n_u32(0x6ED9EBA1), vdupq_n_u32(0x8F1BBCDC), vdupq_n_u32(0xCA62C1D6),
+			};
+
+			auto abcd = vld1q_u32(state);
+			auto e = state[4];
 
-			if (FAILED(BCryptGetProperty(algorithm, BCRYPT_HASH_LENGTH,
-				reinterpret_cast<PBYTE>(&hash_data_length),
-				sizeof(DWORD),
-				&data_count,
-				0)))
+			while (blocks--)
 			{
-				return {};
+				const auto abcd_save = abcd;
+				const auto e_save = e;
+
+				uint32x4_t msg[4];
+				for (auto i = 0; i < 4; ++i)
+				{
+					msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+				}
+
+				for (auto i = 0; i < 20; ++i)
+				{
+					const auto wk = vaddq_u32(msg[i % 4], constants[i / 5]);
+					const auto next_e = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+					if (i < 5) abcd = vsha1cq_u32(abcd, e, wk);
+					else if (i < 10 || i >= 15) abcd = vsha1pq_u32(abcd, e, wk);
+					else abcd = vsha1mq_u32(abcd, e, wk);
+
+					e = next_e;
+
+					// The slot that was just consumed takes the words four groups ahead
+					if (i < 16)
+					{
+						msg[i % 4] = vsha1su1q_u32(vsha1su0q_u32(msg[i % 4], msg[(i + 1) % 4], msg[(i + 2) % 4]), msg[(i + 3) % 4]);
+					}
+				}
+
+				abcd = vaddq_u32(abcd, abcd_save);
+				e += e_save;
+
+				data += 64;
 			}
 
-			std::string hash_obj_data{}, hash_data{};
-			hash_obj_data.resize(hash_obj_length);
-			hash_data.resize(hash_data_length);
+			vst1q_u32(state, abcd);
+			state[4] = e;
+		}
+#endif
+
+		constexpr size_t multi_buffer_lanes = 8;
 
-			BCRYPT_HASH_HANDLE hash_handle{};
+		// Hashes one message per lane, the state holds each word for all lanes side by side.
+		// All lanes advance by the same number of blocks, idle lanes may point at another lane's data.
+		using multi_buffer_function = void(*)(uint32_t (*state)[multi_buffer_lanes], const uint8_t* const* data, size_t blocks);
 
-			if (FAILED(BCryptCreateHash(
-				algorithm,
-				&hash_handle,
-				reinterpret_cast<PBYTE>(hash_obj_data.data()),
-				static_cast<ULONG>(hash_obj_data.size()),
-				NULL,
-				0,
-				0)))
+#ifdef SHA1_HAS_AVX2
+		bool has_avx2()
+		{
+#ifdef _MSC_VER
+			int info[4]{};
+			__cpuid(info, 0);
+			if (info[0] < 7)
 			{
-				return {};
+				return false;
 			}
 
-			if (FAILED(BCryptHashData(hash_handle, const_cast<PBYTE>(data),
-				static_cast<ULONG>(length), 0)))
+			__cpuid(info, 1);
+			const auto has_os_support = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+			__cpuidex(info, 7, 0);
+			const auto has_avx2 = (info[1] & (1 << 5)) != 0;
+#else
+			unsigned int eax{}, ebx{}, ecx{}, edx{};
+			if (__get_cpuid_max(0, nullptr) < 7 || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
 			{
-				return {};
+				return false;
 			}
 
-			if (FAILED(BCryptFinishHash(
-				hash_handle,
-				reinterpret_cast<PBYTE>(hash_data.data()),
-				static_cast<ULONG>(hash_data.size()),
-				0)))
+			// The OS has to save the upper halves of the YMM registers on context switches
+			auto has_os_support = (ecx & (1 << 27)) != 0;
+			if (has_os_support)
 			{
-				return {};
+				unsigned int xcr0{}, xcr0_high{};
+				__asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+				has_os_support = (xcr0 & 6) == 6;
+			}
+
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			const auto has_avx2 = (ebx & (1 << 5)) != 0;
+#endif
+
+			return has_os_support && has_avx2;
+		}
+
+		AVX2_TARGET __m256i rotate_left_x8(const __m256i value, const int count)
+		{
+			return _mm256_or_si256(_mm256_slli_epi32(value, count), _mm256_srli_epi32(value, 32 - count));
+		}
+
+		// Turns eight rows of eight words into eight columns, so word i of every lane ends up in rows[i]
+		AVX2_TARGET void transpose_x8(__m256i* rows)
+		{
+			const auto t0 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+			const auto t1 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+			const auto t2 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+			const auto t3 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+			const auto t4 = _mm256_unpacklo_epi32(rows[4], rows[5]);
+			const auto t5 = _mm256_unpackhi_epi32(rows[4], rows[5]);
+			const auto t6 = _mm256_unpacklo_epi32(rows[6], rows[7]);
+			const auto t7 = _mm256_unpackhi_epi32(rows[6], rows[7]);
+
+			const auto u0 = _mm256_unpacklo_epi64(t0, t2);
+			const auto u1 = _mm256_unpackhi_epi64(t0, t2);
+			const auto u2 = _mm256_unpacklo_epi64(t1, t3);
+			const auto u3 = _mm256_unpackhi_epi64(t1, t3);
+			const auto u4 = _mm256_unpacklo_epi64(t4, t6);
+			const auto u5 = _mm256_unpackhi_epi64(t4, t6);
+			const auto u6 = _mm256_unpacklo_epi64(t5, t7);
+			const auto u7 = _mm256_unpackhi_epi64(t5, t7);
+
+			rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+			rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+			rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+			rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+			rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+			rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+			rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+			rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+		}
+
+		template <int Round>
+		AVX2_TARGET void round_x8(__m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i& e, const __m256i w)
+		{
+			__m256i f, k;
+			if constexpr (Round == 0)
+			{
+				f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+				k = _mm256_set1_epi32(0x5A827999);
+			}
+			else if constexpr (Round == 1)
+			{
+				f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+				k = _mm256_set1_epi32(0x6ED9EBA1);
+			}
+			else if constexpr (Round == 2)
+			{
+				f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+				k = _mm256_set1_epi32(static_cast<int>(0x8F1BBCDC));
+			}
+			else
+			{
+				f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+				k = _mm256_set1_epi32(static_cast<int>(0xCA62C1D6));
+			}
+
+			const auto temp = _mm256_add_epi32(_mm256_add_epi32(rotate_left_x8(a, 5), f), _mm256_add_epi32(_mm256_add_epi32(e, k), w));
+			e = d;
+			d = c;
+			c = rotate_left_x8(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		AVX2_TARGET __m256i schedule_x8(__m256i* w, const int i)
+		{
+			if (i >= 16)
+			{
+				const auto value = _mm256_xor_si256(_mm256_xor_si256(w[(i - 3) & 15], w[(i - 8) & 15]),
+				                                     _mm256_xor_si256(w[(i - 14) & 15], w[i & 15]));
+				w[i & 15] = rotate_left_x8(value, 1);
+			}
+
+			return w[i & 15];
+		}
+
+		// Eight messages at once in the 32-bit lanes of AVX2 registers
+		AVX2_TARGET void process_blocks_avx2(uint32_t (*state)[multi_buffer_lanes], const uint8_t* const* data, size_t blocks)
+		{
+			const auto mask = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+			                                  12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+			__m256i words[5];
+			for (auto i = 0; i < 5; ++i)
+			{
+				words[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[i]));
+			}
+
+			for (size_t offset = 0; offset < blocks * 64; offset += 64)
+			{
+				__m256i w[16];
+				for (auto half = 0; half < 2; ++half)
+				{
+					for (size_t lane = 0; lane < multi_buffer_lanes; ++lane)
+					{
+						w[half * 8 + lane] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data[lane] + offset + half * 32));
+					}
+
+					transpose_x8(w + half * 8);
+				}
+
+				for (auto& word : w)
+				{
+					word = _mm256_shuffle_epi8(word, mask);
+				}
+
+				auto a = words[0], b = words[1], c = words[2], d = words[3], e = words[4];
+
+				for (auto i = 0; i < 20; ++i) round_x8<0>(a, b, c, d, e, schedule_x8(w, i));
+				for (auto i = 20; i < 40; ++i) round_x8<1>(a, b, c, d, e, schedule_x8(w, i));
+				for (auto i = 40; i < 60; ++i) round_x8<2>(a, b, c, d, e, schedule_x8(w, i));
+				for (auto i = 60; i < 80; ++i) round_x8<3>(a, b, c, d, e, schedule_x8(w, i));
+
+				words[0] = _mm256_add_epi32(words[0], a);
+				words[1] = _mm256_add_epi32(words[1], b);
+				words[2] = _mm256_add_epi32(words[2], c);
+				words[3] = _mm256_add_epi32(words[3], d);
+				words[4] = _mm256_add_epi32(words[4], e);
+			}
+
+			for (auto i = 0; i < 5; ++i)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(state[i]), words[i]);
+			}
+		}
+#endif
+
+		struct implementation
+		{
+			const char* name;
+			block_function function;
+		};
+
+		struct multi_buffer_implementation
+		{
+			const char* name;
+			multi_buffer_function function;
+		};
+
+		// Ordered by preference, the scalar implementation is always last
+		const std::vector<implementation>& get_supported_implementations()
+		{
+			static const auto implementations = []
+			{
+				std::vector<implementation> result{};
+
+#ifdef SHA1_HAS_SHA_NI
+				if (has_sha_extensions())
+				{
+					result.push_back({"sha-ni", process_blocks_sha_ni});
+				}
+#endif
+
+#ifdef SHA1_HAS_ARMV8
+				if (has_sha_extensions())
+				{
+					result.push_back({"armv8", process_blocks_armv8});
+				}
+#endif
+
+				result.push_back({"scalar", process_blocks_scalar});
+				return result;
+			}();
+
+			return implementations;
+		}
+
+		const std::vector<multi_buffer_implementation>& get_supported_multi_buffer_implementations()
+		{
+			static const auto implementations = []
+			{
+				std::vector<multi_buffer_implementation> result{};
+
+#ifdef SHA1_HAS_AVX2
+				if (has_avx2())
+				{
+					result.push_back({"avx2-x8", process_blocks_avx2});
+				}
+#endif
+
+				return result;
+			}();
+
+			return implementations;
+		}
+
+		const implementation& get_selected_implementation()
+		{
+			return get_supported_implementations().front();
+		}
+
+		const implementation* find_implementation(const std::string_view name)
+		{
+			for (const auto& entry : get_supported_implementations())
+			{
+				if (entry.name == name)
+				{
+					return &entry;
+				}
+			}
+
+			return nullptr;
+		}
+
+		const multi_buffer_implementation* find_multi_buffer_implementation(const std::string_view name)
+		{
+			for (const auto& entry : get_supported_multi_buffer_implementations())
+			{
+				if (entry.name == name)
+				{
+					return &entry;
+				}
+			}
+
+			return nullptr;
+		}
+
+		std::string get_digest(const uint32_t* state, const bool hex)
+		{
+			std::string hash_data{};
+			hash_data.resize(20);
+
+			for (auto i = 0; i < 5; ++i)
+			{
+				hash_data[i * 4 + 0] = static_cast<char>(state[i] >> 24);
+				hash_data[i * 4 + 1] = static_cast<char>(state[i] >> 16);
+				hash_data[i * 4 + 2] = static_cast<char>(state[i] >> 8);
+				hash_data[i * 4 + 3] = static_cast<char>(state[i]);
 			}
 
 			if (!hex) return hash_data;
 
 			return string::dump_hex(hash_data, "");
 		}
+
+		// Pads the trailing partial block and appends the big-endian message length in bits, which takes one or two blocks
+		size_t get_final_blocks(uint8_t (&blocks)[128], const uint8_t* data, const size_t remaining, const uint64_t length)
+		{
+			std::memset(blocks, 0, sizeof(blocks));
+			std::memcpy(blocks, data, remaining);
+			blocks[remaining] = 0x80;
+
+			const auto size = remaining < 56 ? 64 : 128;
+			const auto bit_length = length * 8;
+
+			for (auto i = 0; i < 8; ++i)
+			{
+				blocks[size - 8 + i] = static_cast<uint8_t>(bit_length >> (56 - i * 8));
+			}
+
+			return size / 64;
+		}
+
+		// Once no inputs are left to fill the lanes, the remaining ones are finished with the single stream function if there is one
+		std::vector<std::string> compute_many_multi_buffer(const std::vector<std::string_view>& data, const multi_buffer_function function,
+		                                                   const block_function finish, const bool hex)
+		{
+			struct lane
+			{
+				size_t input{};
+				const uint8_t* blocks{};
+				size_t block_count{};
+				uint8_t final_blocks[128]{};
+				size_t final_block_count{};
+				bool active{};
+			};
+
+			std::vector<std::string> result(data.size());
+
+			uint32_t state[5][multi_buffer_lanes]{};
+			lane lanes[multi_buffer_lanes]{};
+			size_t next_input = 0;
+
+			const auto start_next_input = [&](const size_t index)
+			{
+				auto& entry = lanes[index];
+				entry.active = next_input < data.size();
+				if (!entry.active)
+				{
+					return;
+				}
+
+				const auto& input = data[next_input];
+				const auto* input_data = reinterpret_cast<const uint8_t*>(input.data());
+
+				entry.input = next_input++;
+				entry.blocks = input_data;
+				entry.block_count = input.size() / 64;
+				entry.final_block_count = get_final_blocks(entry.final_blocks, input_data + entry.block_count * 64,
+				                                           input.size() % 64, input.size());
+
+				for (auto i = 0; i < 5; ++i)
+				{
+					state[i][index] = initial_state[i];
+				}
+			};
+
+			for (size_t i = 0; i < multi_buffer_lanes; ++i)
+			{
+				start_next_input(i);
+			}
+
+			while (finish == nullptr || next_input < data.size())
+			{
+				// The lanes advance together until the first of them runs out of the blocks at hand
+				const uint8_t* pointers[multi_buffer_lanes]{};
+				size_t blocks = std::numeric_limits<size_t>::max();
+
+				for (size_t i = 0; i < multi_buffer_lanes; ++i)
+				{
+					auto& entry = lanes[i];
+					if (!entry.active)
+					{
+						continue;
+					}
+
+					if (entry.block_count == 0)
+					{
+						entry.blocks = entry.final_blocks;
+						entry.block_count = std::exchange(entry.final_block_count, 0);
+					}
+
+					pointers[i] = entry.blocks;
+					blocks = std::min(blocks, entry.block_count);
+				}
+
+				if (blocks == std::numeric_limits<size_t>::max())
+				{
+					break;
+				}
+
+				// Idle lanes hash along with an active one, their state is reset before it is used again
+				const auto* active_pointer = *std::ranges::find_if(pointers, [](const uint8_t* pointer)
+				{
+					return pointer != nullptr;
+				});
+
+				for (auto& pointer : pointers)
+				{
+					if (!pointer)
+					{
+						pointer = active_pointer;
+					}
+				}
+
+				function(state, pointers, blocks);
+
+				for (size_t i = 0; i < multi_buffer_lanes; ++i)
+				{
+					auto& entry = lanes[i];
+					if (!entry.active)
+					{
+						continue;
+					}
+
+					entry.blocks += blocks * 64;
+					entry.block_count -= blocks;
+
+					if (entry.block_count == 0 && entry.final_block_count == 0)
+					{
+						const uint32_t lane_state[5] = {state[0][i], state[1][i], state[2][i], state[3][i], state[4][i]};
+						result[entry.input] = get_digest(lane_state, hex);
+						start_next_input(i);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < multi_buffer_lanes; ++i)
+			{
+				const auto& entry = lanes[i];
+				if (!entry.active || !finish)
+				{
+					continue;
+				}
+
+				uint32_t lane_state[5] = {state[0][i], state[1][i], state[2][i], state[3][i], state[4][i]};
+				finish(lane_state, entry.blocks, entry.block_count);
+				finish(lane_state, entry.final_blocks, entry.final_block_count);
+
+				result[entry.input] = get_digest(lane_state, hex);
+			}
+
+			return result;
+		}
+	}
+
+	sha1::context::context()
+		: process_blocks_(get_selected_implementation().function)
+	{
+		this->reset();
+	}
+
+	sha1::context::context(const std::string_view implementation)
+	{
+		const auto* entry = find_implementation(implementation);
+		if (!entry)
+		{
+			throw std::invalid_argument("Unsupported SHA-1 implementation: " + std::string(implementation));
+		}
+
+		this->process_blocks_ = entry->function;
+		this->reset();
+	}
+
+	void sha1::context::reset()
+	{
+		std::memcpy(this->state_, initial_state, sizeof(this->state_));
+		this->length_ = 0;
+		this->buffer_size_ = 0;
+	}
+
+	void sha1::context::update(const std::string& data)
+	{
+		this->update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+	}
+
+	void sha1::context::update(const uint8_t* data, size_t length)
+	{
+		const auto process_blocks = this->process_blocks_;
+
+		this->length_ += length;
+
+		if (this->buffer_size_ > 0)
+		{
+			const auto count = std::min(length, sizeof(this->buffer_) - this->buffer_size_);
+			std::memcpy(this->buffer_ + this->buffer_size_, data, count);
+
+			this->buffer_size_ += count;
+			data += count;
+			length -= count;
+
+			if (this->buffer_size_ < sizeof(this->buffer_))
+			{
+				return;
+			}
+
+			process_blocks(this->state_, this->buffer_, 1);
+			this->buffer_size_ = 0;
+		}
+
+		const auto blocks = length / sizeof(this->buffer_);
+		if (blocks > 0)
+		{
+			process_blocks(this->state_, data, blocks);
+			data += blocks * sizeof(this->buffer_);
+			length -= blocks * sizeof(this->buffer_);
+		}
+
+		if (length > 0)
+		{
+			std::memcpy(this->buffer_, data, length);
+			this->buffer_size_ = length;
+		}
+	}
+
+	std::string sha1::context::finalize(const bool hex)
+	{
+		const auto bit_length = this->length_ * 8;
+
+		uint8_t padding[72]{};
+		padding[0] = 0x80;
+
+		// Pad to 56 bytes within the last block, followed by the big-endian message length in bits
+		const auto padding_length = (this->buffer_size_ < 56 ? 56 : 120) - this->buffer_size_;
+		for (auto i = 0; i < 8; ++i)
+		{
+			padding[padding_length + i] = static_cast<uint8_t>(bit_length >> (56 - i * 8));
+		}
+
+		this->update(padding, padding_length + 8);
+
+		auto hash_data = get_digest(this->state_, hex);
+		this->reset();
+
+		return hash_data;
 	}
 
 	std::string sha1::compute(const std::string& data, const bool hex)
@@ -90,6 +940,399 @@ namespace utils::cryptography
 
 	std::string sha1::compute(const uint8_t* data, const size_t length, const bool hex)
 	{
-		return compute_hash(BCRYPT_SHA1_ALGORITHM, data, length, hex);
+		context context{};
+		context.update(data, length);
+		return context.finalize(hex);
+	}
+
+	std::vector<std::string> sha1::compute_many(const std::vector<std::string_view>& data, const bool hex)
+	{
+		const auto& multi_buffer_implementations = get_supported_multi_buffer_implementations();
+		if (multi_buffer_implementations.empty())
+		{
+			return compute_many_with(get_selected_implementation().name, data, hex);
+		}
+
+		// Filled lanes beat even a hardware single stream in sha1_throughput, partly filled ones don't, so it takes over the last inputs
+		const auto selected = get_selected_implementation().function;
+		const auto finish = selected == process_blocks_scalar ? nullptr : selected;
+
+		return compute_many_multi_buffer(data, multi_buffer_implementations.front().function, finish, hex);
+	}
+
+	std::vector<std::string> sha1::compute_many_with(const std::string_view implementation, const std::vector<std::string_view>& data,
+	                                                 const bool hex)
+	{
+		if (const auto* entry = find_multi_buffer_implementation(implementation))
+		{
+			return compute_many_multi_buffer(data, entry->function, nullptr, hex);
+		}
+
+		context context{implementation};
+
+		std::vector<std::string> result{};
+		result.reserve(data.size());
+
+		for (const auto& entry : data)
+		{
+			context.update(reinterpret_cast<const uint8_t*>(entry.data()), entry.size());
+			result.emplace_back(context.finalize(hex));
+		}
+
+		return result;
+	}
+
+	const char* sha1::get_implementation()
+	{
+		return get_selected_implementation().name;
+	}
+
+	std::vector<const char*> sha1::get_implementations()
+	{
+		std::vector<const char*> names{};
+
+		for (const auto& entry : get_supported_implementations())
+		{
+			names.push_back(entry.name);
+		}
+
+		for (const auto& entry : get_supported_multi_buffer_implementations())
+		{
+			names.push_back(entry.name);
+		}
+
+		return names;
+	}
+
+	namespace
+	{
+		namespace blake3_impl
+		{
+			constexpr size_t block_length = 64;
+			constexpr size_t chunk_length = 1024;
+
+			// Subtrees handed to the thread pool must span a power of two chunks
+			constexpr size_t parallel_subtree_length = 8 * 1024 * 1024;
+
+			constexpr uint32_t chunk_start = 1 << 0;
+			constexpr uint32_t chunk_end = 1 << 1;
+			constexpr uint32_t parent = 1 << 2;
+			constexpr uint32_t root = 1 << 3;
+
+			constexpr uint32_t iv[8] = {
+				0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+			};
+
+			constexpr uint8_t message_schedule[7][16] = {
+				{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+				{2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+				{3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+				{10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+				{12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+				{9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+				{11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+			};
+
+			struct chaining_value
+			{
+				uint32_t words[8];
+			};
+
+			uint32_t rotate_right(const uint32_t value, const int count)
+			{
+				return (value >> count) | (value << (32 - count));
+			}
+
+			uint32_t load_little_endian(const uint8_t* data)
+			{
+				return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8)
+					| (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+			}
+
+			void mix(uint32_t* state, const size_t a, const size_t b, const size_t c, const size_t d, const uint32_t x, const uint32_t y)
+			{
+				state[a] = state[a] + state[b] + x;
+				state[d] = rotate_right(state[d] ^ state[a], 16);
+				state[c] = state[c] + state[d];
+				state[b] = rotate_right(state[b] ^ state[c], 12);
+				state[a] = state[a] + state[b] + y;
+				state[d] = rotate_right(state[d] ^ state[a], 8);
+				state[c] = state[c] + state[d];
+				state[b] = rotate_right(state[b] ^ state[c], 7);
+			}
+
+			void compress(const chaining_value& cv, const uint8_t* block, const uint32_t block_len, const uint64_t counter,
+			              const uint32_t flags, uint32_t* out)
+			{
+				uint32_t message[16];
+				for (size_t i = 0; i < 16; ++i)
+				{
+					message[i] = load_little_endian(block + i * 4);
+				}
+
+				uint32_t state[16] = {
+					cv.words[0], cv.words[1], cv.words[2], cv.words[3],
+					cv.words[4], cv.words[5], cv.words[6], cv.words[7],
+					iv[0], iv[1], iv[2], iv[3],
+					static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), block_len, flags,
+				};
+
+				for (const auto& schedule : message_schedule)
+				{
+					mix(state, 0, 4, 8, 12, message[schedule[0]], message[schedule[1]]);
+					mix(state, 1, 5, 9, 13, message[schedule[2]], message[schedule[3]]);
+					mix(state, 2, 6, 10, 14, message[schedule[4]], message[schedule[5]]);
+					mix(state, 3, 7, 11, 15, message[schedule[6]], message[schedule[7]]);
+					mix(state, 0, 5, 10, 15, message[schedule[8]], message[schedule[9]]);
+					mix(state, 1, 6, 11, 12, message[schedule[10]], message[schedule[11]]);
+					mix(state, 2, 7, 8, 13, message[schedule[12]], message[schedule[13]]);
+					mix(state, 3, 4, 9, 14, message[schedule[14]], message[schedule[15]]);
+				}
+
+				for (size_t i = 0; i < 8; ++i)
+				{
+					out[i] = state[i] ^ state[i + 8];
+					out[i + 8] = state[i + 8] ^ cv.words[i];
+				}
+			}
+
+			// Inputs of the last compression of a node, kept until it is known whether the node is the root
+			struct node_output
+			{
+				chaining_value cv{};
+				uint8_t block[block_length]{};
+				uint32_t block_len{};
+				uint64_t counter{};
+				uint32_t flags{};
+
+				[[nodiscard]] chaining_value get_chaining_value() const
+				{
+					uint32_t out[16];
+					compress(this->cv, this->block, this->block_len, this->counter, this->flags, out);
+
+					chaining_value result{};
+					std::memcpy(result.words, out, sizeof(result.words));
+					return result;
+				}
+
+				[[nodiscard]] std::string get_root_hash() const
+				{
+					uint32_t out[16];
+					compress(this->cv, this->block, this->block_len, 0, this->flags | root, out);
+
+					std::string hash{};
+					hash.resize(32);
+
+					for (size_t i = 0; i < 8; ++i)
+					{
+						hash[i * 4 + 0] = static_cast<char>(out[i]);
+						hash[i * 4 + 1] = static_cast<char>(out[i] >> 8);
+						hash[i * 4 + 2] = static_cast<char>(out[i] >> 16);
+						hash[i * 4 + 3] = static_cast<char>(out[i] >> 24);
+					}
+
+					return hash;
+				}
+			};
+
+			node_output get_chunk_output(const uint8_t* data, const size_t length, const uint64_t chunk_counter)
+			{
+				node_output output{};
+				std::memcpy(output.cv.words, iv, sizeof(output.cv.words));
+
+				auto flags = chunk_start;
+				size_t offset = 0;
+
+				// Every block but the last one is compressed right away
+				while (length - offset > block_length)
+				{
+					uint32_t out[16];
+					compress(output.cv, data + offset, block_length, chunk_counter, flags, out);
+					std::memcpy(output.cv.words, out, sizeof(output.cv.words));
+
+					flags = 0;
+					offset += block_length;
+				}
+
+				const auto remaining = length - offset;
+				if (remaining > 0)
+				{
+					std::memcpy(output.block, data + offset, remaining);
+				}
+
+				output.block_len = static_cast<uint32_t>(remaining);
+				output.counter = chunk_counter;
+				output.flags = flags | chunk_end;
+
+				return output;
+			}
+
+			node_output get_parent_output(const chaining_value& left, const chaining_value& right)
+			{
+				node_output output{};
+				std::memcpy(output.cv.words, iv, sizeof(output.cv.words));
+
+				for (size_t i = 0; i < 8; ++i)
+				{
+					for (size_t j = 0; j < 4; ++j)
+					{
+						output.block[i * 4 + j] = static_cast<uint8_t>(left.words[i] >> (j * 8));
+						output.block[32 + i * 4 + j] = static_cast<uint8_t>(right.words[i] >> (j * 8));
+					}
+				}
+
+				output.block_len = block_length;
+				output.flags = parent;
+
+				return output;
+			}
+
+			// Chaining value of a complete subtree spanning a power of two chunks
+			chaining_value get_subtree_chaining_value(const uint8_t* data, const size_t length, const uint64_t chunk_counter)
+			{
+				if (length <= chunk_length)
+				{
+					return get_chunk_output(data, length, chunk_counter).get_chaining_value();
+				}
+
+				const auto half = length / 2;
+				const auto left = get_subtree_chaining_value(data, half, chunk_counter);
+				const auto right = get_subtree_chaining_value(data + half, length - half, chunk_counter + half / chunk_length);
+
+				return get_parent_output(left, right).get_chaining_value();
+			}
+
+			class hasher
+			{
+			public:
+				// Pushes the chaining value of a complete subtree that starts at the current position
+				void push_subtree(const chaining_value& cv, const size_t chunks)
+				{
+					this->merge_stack();
+					this->stack_.emplace_back(cv);
+					this->chunk_counter_ += chunks;
+				}
+
+				void update(const uint8_t* data, const size_t length)
+				{
+					// Chunks are only pushed once more data follows, the last one might be the root
+					for (size_t offset = 0; offset < length; offset += chunk_length)
+					{
+						if (this->pending_)
+						{
+							this->merge_stack();
+							this->stack_.emplace_back(this->pending_->get_chaining_value());
+							this->pending_.reset();
+							++this->chunk_counter_;
+						}
+
+						const auto size = std::min(chunk_length, length - offset);
+						this->pending_ = get_chunk_output(data + offset, size, this->chunk_counter_);
+					}
+
+					// Completed subtrees left of the pending chunk must be merged before finalizing
+					this->merge_stack();
+				}
+
+				std::string finalize()
+				{
+					if (this->stack_.empty())
+					{
+						return this->pending_.value_or(get_chunk_output(nullptr, 0, 0)).get_root_hash();
+					}
+
+					auto remaining = this->stack_.size();
+					node_output output{};
+
+					if (this->pending_)
+					{
+						output = *this->pending_;
+					}
+					else
+					{
+						remaining -= 2;
+						output = get_parent_output(this->stack_[remaining], this->stack_[remaining + 1]);
+					}
+
+					while (remaining > 0)
+					{
+						--remaining;
+						output = get_parent_output(this->stack_[remaining], output.get_chaining_value());
+					}
+
+					return output.get_root_hash();
+				}
+
+			private:
+				std::vector<chaining_value> stack_{};
+				std::optional<node_output> pending_{};
+				uint64_t chunk_counter_{};
+
+				// The stack holds one entry per set bit of the number of completed chunks
+				void merge_stack()
+				{
+					const auto target_size = static_cast<size_t>(std::popcount(this->chunk_counter_));
+					while (this->stack_.size() > target_size)
+					{
+						const auto right = this->stack_.back();
+						this->stack_.pop_back();
+
+						const auto left = this->stack_.back();
+						this->stack_.pop_back();
+
+						this->stack_.emplace_back(get_parent_output(left, right).get_chaining_value());
+					}
+				}
+			};
+
+			std::string to_result(const std::string& hash, const bool hex)
+			{
+				if (!hex) return hash;
+				return string::dump_hex(hash, "");
+			}
+		}
+	}
+
+	std::string blake3::compute(const std::string& data, const bool hex)
+	{
+		return compute(reinterpret_cast<const uint8_t*>(data.data()), data.size(), hex);
+	}
+
+	std::string blake3::compute(const uint8_t* data, const size_t length, const bool hex)
+	{
+		blake3_impl::hasher hasher{};
+		hasher.update(data, length);
+		return blake3_impl::to_result(hasher.finalize(), hex);
+	}
+
+	std::string blake3::compute_parallel(const uint8_t* data, const size_t length, const bool hex)
+	{
+		constexpr auto subtree_length = blake3_impl::parallel_subtree_length;
+		if (length <= subtree_length)
+		{
+			return compute(data, length, hex);
+		}
+
+		// The tail keeps at least one byte, so the root is always produced by the sequential hasher
+		const auto subtree_count = (length - 1) / subtree_length;
+		std::vector<blake3_impl::chaining_value> subtrees(subtree_count);
+
+		thread_pool::get().parallel_for(subtree_count, [&](const size_t index)
+		{
+			const auto offset = index * subtree_length;
+			subtrees[index] = blake3_impl::get_subtree_chaining_value(data + offset, subtree_length,
+			                                                          offset / blake3_impl::chunk_length);
+		});
+
+		blake3_impl::hasher hasher{};
+		for (const auto& subtree : subtrees)
+		{
+			hasher.push_subtree(subtree, subtree_length / blake3_impl::chunk_length);
+		}
+
+		const auto tail_offset = subtree_count * subtree_length;
+		hasher.update(data + tail_offset, length - tail_offset);
+
+		return blake3_impl::to_result(hasher.finalize(), hex);
 	}
 }
@@ -1,12 +1,59 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
 
 namespace utils::cryptography
 {
 	namespace sha1
 	{
+		using block_function = void(*)(uint32_t* state, const uint8_t* data, size_t blocks);
+
+		class context
+		{
+		public:
+			context();
+
+			// Uses the named single stream implementation instead of the one picked for this CPU
+			explicit context(std::string_view implementation);
+
+			void reset();
+			void update(const std::string& data);
+			void update(const uint8_t* data, size_t length);
+			std::string finalize(bool hex = false);
+
+		private:
+			uint32_t state_[5]{};
+			uint64_t length_{};
+			uint8_t buffer_[64]{};
+			size_t buffer_size_{};
+			block_function process_blocks_{};
+		};
+
 		std::string compute(const std::string& data, bool hex = false);
 		std::string compute(const uint8_t* data, size_t length, bool hex = false);
+
+		// Hashes independent inputs, several at once in SIMD lanes where that beats hashing them one by one
+		std::vector<std::string> compute_many(const std::vector<std::string_view>& data, bool hex = false);
+
+		// Same with the named implementation, meant for cross-checking them against each other
+		std::vector<std::string> compute_many_with(std::string_view implementation, const std::vector<std::string_view>& data, bool hex = false);
+
+		// Name of the block function picked for this CPU
+		const char* get_implementation();
+
+		// Every implementation this CPU supports, single stream ones first, any of them can be passed to compute_many_with
+		std::vector<const char*> get_implementations();
+	}
+
+	namespace blake3
+	{
+		std::string compute(const std::string& data, bool hex = false);
+		std::string compute(const uint8_t* data, size_t length, bool hex = false);
+
+		// Splits large inputs into independent subtrees that are hashed on the shared thread pool
+		std::string compute_parallel(const uint8_t* data, size_t length, bool hex = false);
 	}
 }
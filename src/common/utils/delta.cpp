@@ -0,0 +1,121 @@
+#include "delta.hpp"
+
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace utils::delta
+{
+	namespace
+	{
+		constexpr std::string_view patch_magic = "XLDELTA1";
+		constexpr size_t output_buffer_size = 64 * 1024;
+
+		class patch_reader
+		{
+		public:
+			patch_reader(const std::string_view data)
+				: data_(data)
+			{
+			}
+
+			std::string_view read(const uint64_t length)
+			{
+				if (length > this->data_.size() - this->offset_)
+				{
+					throw std::runtime_error("Patch is truncated");
+				}
+
+				const auto result = this->data_.substr(this->offset_, static_cast<size_t>(length));
+				this->offset_ += static_cast<size_t>(length);
+				return result;
+			}
+
+			uint64_t read_integer()
+			{
+				const auto bytes = this->read(8);
+
+				uint64_t value = 0;
+				for (size_t i = 0; i < 8; ++i)
+				{
+					value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (i * 8);
+				}
+
+				return value;
+			}
+
+			[[nodiscard]] bool is_at_end() const
+			{
+				return this->offset_ == this->data_.size();
+			}
+
+		private:
+			std::string_view data_;
+			size_t offset_{};
+		};
+	}
+
+	void apply(const std::string_view source, const std::string_view patch, const std::function<void(std::string_view)>& output)
+	{
+		patch_reader reader{patch};
+		if (reader.read(patch_magic.size()) != patch_magic)
+		{
+			throw std::runtime_error("Invalid patch header");
+		}
+
+		const auto target_size = reader.read_integer();
+
+		uint64_t written = 0;
+		// Kept unsigned so hostile seeks wrap instead of overflowing, a wrapped
+		// offset is past the source and rejected by the range check below
+		uint64_t source_offset = 0;
+
+		std::string buffer{};
+		buffer.resize(output_buffer_size);
+
+		while (written < target_size)
+		{
+			const auto diff_length = reader.read_integer();
+			const auto extra_length = reader.read_integer();
+			const auto seek = reader.read_integer();
+
+			if (diff_length > target_size - written || extra_length > target_size - written - diff_length)
+			{
+				throw std::runtime_error("Patch exceeds the target size");
+			}
+
+			if (source_offset > source.size() || diff_length > source.size() - source_offset)
+			{
+				throw std::runtime_error("Patch reads outside of the source");
+			}
+
+			const auto diff = reader.read(diff_length);
+			const auto* source_data = source.data() + source_offset;
+
+			for (size_t offset = 0; offset < diff.size(); offset += buffer.size())
+			{
+				const auto length = std::min(buffer.size(), diff.size() - offset);
+				for (size_t i = 0; i < length; ++i)
+				{
+					buffer[i] = static_cast<char>(source_data[offset + i] + diff[offset + i]);
+				}
+
+				output({buffer.data(), length});
+			}
+
+			const auto extra = reader.read(extra_length);
+			if (!extra.empty())
+			{
+				output(extra);
+			}
+
+			written += diff_length + extra_length;
+			source_offset += diff_length + seek;
+		}
+
+		if (!reader.is_at_end())
+		{
+			throw std::runtime_error("Patch has trailing data");
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <string_view>
+
+namespace utils::delta
+{
+	// Applies a bsdiff style patch with uncompressed, interleaved streams:
+	//   "XLDELTA1", uint64 target size,
+	//   then records of uint64 diff length, uint64 extra length, int64 source seek,
+	//   followed by the diff bytes (added to the source) and the extra bytes (copied as-is).
+	// All integers are little-endian. Malformed patches throw a std::runtime_error.
+	void apply(std::string_view source, std::string_view patch, const std::function<void(std::string_view)>& output);
+}
@@ -2,83 +2,786 @@
 #include <curl/curl.h>
 #include <gsl/gsl>
 
+#include <deque>
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "concurrency.hpp"
+#include "string.hpp"
+#include "logger.hpp"
+
 #pragma comment(lib, "ws2_32.lib")
 
 namespace utils::http
 {
 	namespace
 	{
-		struct progress_helper
+		// Received data waiting for the requesting thread, the transfer is paused while this much is queued
+		constexpr size_t max_queued_size = 4 * 1024 * 1024;
+
+		// A single attempt, performed by the engine thread and consumed by the thread that requested it
+		struct transfer
 		{
-			const std::function<void(size_t)>* callback{};
-			std::exception_ptr exception{};
+			CURL* curl{};
+
+			std::mutex mutex{};
+			std::condition_variable event{};
+			std::deque<std::string> chunks{};
+			size_t queued_size{};
+			bool paused{};
+			bool done{};
+			long response_code{};
+			headers response_headers{};
+			CURLcode result{CURLE_OK};
 		};
 
-		int progress_callback(void* clientp, const curl_off_t /*dltotal*/, const curl_off_t dlnow,
-		                      const curl_off_t /*ultotal*/, const curl_off_t /*ulnow*/)
+		// Bytes received by all transfers, sampled by the concurrency controller
+		std::atomic<std::uint64_t> received_size{0};
+
+		size_t write_callback(void* contents, const size_t size, const size_t nmemb, void* userp)
 		{
-			auto* helper = static_cast<progress_helper*>(clientp);
+			auto* current = static_cast<transfer*>(userp);
+			const auto total_size = size * nmemb;
+
+			std::lock_guard<std::mutex> _{current->mutex};
 
-			try
+			// The requesting thread resumes the transfer once it caught up, curl hands out the same data again
+			if (current->queued_size >= max_queued_size)
 			{
-				if (*helper->callback)
-				{
-					(*helper->callback)(dlnow);
-				}
+				current->paused = true;
+				return CURL_WRITEFUNC_PAUSE;
 			}
-			catch (...)
+
+			if (!current->response_code)
 			{
-				helper->exception = std::current_exception();
-				return -1;
+				curl_easy_getinfo(current->curl, CURLINFO_RESPONSE_CODE, &current->response_code);
 			}
 
-			return 0;
+			current->chunks.emplace_back(static_cast<char*>(contents), total_size);
+			current->queued_size += total_size;
+			received_size += total_size;
+			current->event.notify_one();
+
+			return total_size;
 		}
 
-		size_t write_callback(void* contents, const size_t size, const size_t nmemb, void* userp)
+		size_t header_callback(char* buffer, const size_t size, const size_t nitems, void* userdata)
 		{
-			auto* buffer = static_cast<std::string*>(userp);
+			auto* current = static_cast<transfer*>(userdata);
+			const auto total_size = size * nitems;
+			const std::string line(buffer, total_size);
+
+			std::lock_guard<std::mutex> _{current->mutex};
+
+			// Every response of a redirect chain starts with its own status line
+			if (string::starts_with(line, "HTTP/"))
+			{
+				current->response_headers.clear();
+				return total_size;
+			}
+
+			const auto separator = line.find(':');
+			if (separator != std::string::npos)
+			{
+				auto value = line.substr(separator + 1);
+				value.erase(0, value.find_first_not_of(" \t"));
+				value.erase(value.find_last_not_of(" \t\r\n") + 1);
+
+				current->response_headers[string::to_lower(line.substr(0, separator))] = std::move(value);
+			}
 
-			const auto total_size = size * nmemb;
-			buffer->append(static_cast<char*>(contents), total_size);
 			return total_size;
 		}
+
+		// Grows the number of active transfers while that raises the aggregate throughput and halves it on errors (AIMD),
+		// so a fast link gets saturated while a slow or lossy one isn't flooded with connections
+		class concurrency_controller
+		{
+		public:
+			concurrency_controller(const size_t limit, const size_t max_limit)
+				: limit_(std::min(limit, max_limit))
+				, max_limit_(max_limit)
+			{
+			}
+
+			void set_max_limit(const size_t max_limit)
+			{
+				this->max_limit_ = max_limit;
+				this->limit_ = std::min(this->limit_.load(), max_limit);
+			}
+
+			[[nodiscard]] size_t get_limit() const
+			{
+				return this->limit_;
+			}
+
+			[[nodiscard]] size_t get_max_limit() const
+			{
+				return this->max_limit_;
+			}
+
+			void add_error()
+			{
+				++this->errors_;
+			}
+
+			// Only called from the engine thread, saturated means transfers were waiting for a free slot
+			void sample(const size_t active, const bool saturated)
+			{
+				const auto now = std::chrono::steady_clock::now();
+				const auto elapsed = now - this->window_start_;
+				if (elapsed < std::chrono::seconds(1))
+				{
+					return;
+				}
+
+				const auto received = received_size.load();
+				const auto window_size = received - this->window_received_;
+				const auto milliseconds = std::max(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()), 1ull);
+				const auto throughput = (window_size * 1000) / milliseconds;
+
+				this->window_start_ = now;
+				this->window_received_ = received;
+
+				const auto errors = std::exchange(this->errors_, 0);
+				if (active == 0 && errors == 0)
+				{
+					return;
+				}
+
+				const auto previous_limit = this->limit_.load();
+				auto limit = previous_limit;
+
+				if (errors > 0)
+				{
+					limit = std::max(limit / 2, static_cast<size_t>(1));
+					this->slow_start_ = false;
+				}
+				else if (saturated && limit < this->max_limit_)
+				{
+					// The last increase didn't pay off, stay here for a while before probing again
+					if (this->increased_ && throughput < this->last_throughput_ + this->last_throughput_ / 20)
+					{
+						limit = std::max(limit - 1, static_cast<size_t>(1));
+						this->slow_start_ = false;
+						this->cooldown_ = 5;
+					}
+					else if (this->cooldown_ > 0)
+					{
+						--this->cooldown_;
+					}
+					else
+					{
+						limit = this->slow_start_ ? limit * 2 : limit + 1;
+					}
+				}
+
+				limit = std::min(limit, this->max_limit_.load());
+
+				this->increased_ = limit > previous_limit;
+				this->last_throughput_ = throughput;
+				this->limit_ = limit;
+
+				logger::write("Transfer concurrency {} -> {} at {} KB/s with {} active transfers and {} errors", previous_limit, limit,
+				              throughput / 1024, active, errors);
+			}
+
+		private:
+			std::atomic<size_t> limit_{};
+			std::atomic<size_t> max_limit_{};
+
+			std::chrono::steady_clock::time_point window_start_{std::chrono::steady_clock::now()};
+			std::uint64_t window_received_{};
+			std::uint64_t last_throughput_{};
+			size_t errors_{};
+			size_t cooldown_{};
+			bool increased_{};
+			bool slow_start_{true};
+		};
+
+		// Drives all transfers from a single thread, so the number of downloads doesn't depend on the number of threads
+		class transfer_engine
+		{
+		public:
+			transfer_engine()
+				: multi_(curl_multi_init())
+			{
+				if (!this->multi_)
+				{
+					throw std::runtime_error("Failed to initialize curl multi handle");
+				}
+
+				// Requests to the same host share one HTTP/2 connection when possible, HTTP/1.1 falls back to a pool
+				curl_multi_setopt(this->multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+				curl_multi_setopt(this->multi_, CURLMOPT_MAX_HOST_CONNECTIONS, 16L);
+
+				this->thread_ = std::thread([this]()
+				{
+					this->run();
+				});
+			}
+
+			~transfer_engine()
+			{
+				this->commands_.access([](command_queue& commands)
+				{
+					commands.stopped = true;
+				});
+
+				curl_multi_wakeup(this->multi_);
+
+				if (this->thread_.joinable())
+				{
+					this->thread_.join();
+				}
+
+				curl_multi_cleanup(this->multi_);
+			}
+
+			transfer_engine(transfer_engine&&) = delete;
+			transfer_engine(const transfer_engine&) = delete;
+			transfer_engine& operator=(transfer_engine&&) = delete;
+			transfer_engine& operator=(const transfer_engine&) = delete;
+
+			void submit(std::shared_ptr<transfer> request)
+			{
+				this->post([request = std::move(request)](command_queue& commands)
+				{
+					commands.pending.emplace_back(std::move(request));
+				});
+			}
+
+			void resume(std::shared_ptr<transfer> request)
+			{
+				this->post([request = std::move(request)](command_queue& commands)
+				{
+					commands.resumed.emplace_back(std::move(request));
+				});
+			}
+
+			void cancel(std::shared_ptr<transfer> request)
+			{
+				this->post([request = std::move(request)](command_queue& commands)
+				{
+					commands.cancelled.emplace_back(std::move(request));
+				});
+			}
+
+			void set_max_transfers(const size_t max_transfers)
+			{
+				this->controller_.set_max_limit(std::max(max_transfers, static_cast<size_t>(1)));
+				curl_multi_wakeup(this->multi_);
+			}
+
+			[[nodiscard]] size_t get_max_transfers() const
+			{
+				return this->controller_.get_max_limit();
+			}
+
+			static transfer_engine& get()
+			{
+				static transfer_engine engine{};
+				return engine;
+			}
+
+		private:
+			struct command_queue
+			{
+				bool stopped{};
+				std::deque<std::shared_ptr<transfer>> pending{};
+				std::vector<std::shared_ptr<transfer>> resumed{};
+				std::vector<std::shared_ptr<transfer>> cancelled{};
+			};
+
+			CURLM* multi_{};
+			std::thread thread_{};
+
+			// Multiplexed streams are cheap, so many more transfers can be in flight than there are connections
+			concurrency_controller controller_{4, supports_http2() ? 64u : 16u};
+			bool saturated_{};
+
+			concurrency::container<command_queue> commands_{};
+			std::unordered_map<CURL*, std::shared_ptr<transfer>> active_{};
+
+			template <typename F>
+			void post(const F& callback)
+			{
+				this->commands_.access(callback);
+				curl_multi_wakeup(this->multi_);
+			}
+
+			void finish(const std::shared_ptr<transfer>& request, const CURLcode result)
+			{
+				curl_multi_remove_handle(this->multi_, request->curl);
+				this->active_.erase(request->curl);
+
+				std::lock_guard<std::mutex> _{request->mutex};
+				curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &request->response_code);
+				request->result = result;
+				request->done = true;
+				request->event.notify_one();
+
+				// Only transport failures and overloaded servers count, missing files are no reason to back off
+				const auto overloaded = request->response_code == 429 || request->response_code >= 500;
+				if (result != CURLE_OK && result != CURLE_ABORTED_BY_CALLBACK && (result != CURLE_HTTP_RETURNED_ERROR || overloaded))
+				{
+					this->controller_.add_error();
+				}
+			}
+
+			// Completes a request that never made it into the multi handle
+			static void abort_request(const std::shared_ptr<transfer>& request)
+			{
+				std::lock_guard<std::mutex> _{request->mutex};
+				request->result = CURLE_ABORTED_BY_CALLBACK;
+				request->done = true;
+				request->event.notify_one();
+			}
+
+			bool process_commands()
+			{
+				command_queue commands{};
+				std::vector<std::shared_ptr<transfer>> aborted{};
+				bool stopped{};
+
+				this->commands_.access([&](command_queue& queue)
+				{
+					stopped = queue.stopped;
+					commands.resumed = std::move(queue.resumed);
+					commands.cancelled = std::move(queue.cancelled);
+					queue.resumed.clear();
+					queue.cancelled.clear();
+
+					// Requests cancelled before they were started never reach the multi handle
+					for (const auto& request : commands.cancelled)
+					{
+						const auto entry = std::ranges::find(queue.pending, request);
+						if (entry != queue.pending.end())
+						{
+							aborted.emplace_back(std::move(*entry));
+							queue.pending.erase(entry);
+						}
+					}
+
+					while (!queue.pending.empty() && (stopped || this->active_.size() + commands.pending.size() < this->controller_.get_limit()))
+					{
+						commands.pending.emplace_back(std::move(queue.pending.front()));
+						queue.pending.pop_front();
+					}
+
+					this->saturated_ = !queue.pending.empty();
+				});
+
+				for (const auto& request : aborted)
+				{
+					abort_request(request);
+				}
+
+				for (auto& request : commands.pending)
+				{
+					if (stopped || curl_multi_add_handle(this->multi_, request->curl) != CURLM_OK)
+					{
+						abort_request(request);
+						continue;
+					}
+
+					this->active_.emplace(request->curl, std::move(request));
+				}
+
+				for (const auto& request : commands.cancelled)
+				{
+					if (this->active_.contains(request->curl))
+					{
+						this->finish(request, CURLE_ABORTED_BY_CALLBACK);
+					}
+				}
+
+				for (const auto& request : commands.resumed)
+				{
+					if (this->active_.contains(request->curl))
+					{
+						curl_easy_pause(request->curl, CURLPAUSE_CONT);
+					}
+				}
+
+				if (stopped)
+				{
+					while (!this->active_.empty())
+					{
+						const auto request = this->active_.begin()->second;
+						this->finish(request, CURLE_ABORTED_BY_CALLBACK);
+					}
+				}
+
+				return !stopped;
+			}
+
+			void run()
+			{
+				while (this->process_commands())
+				{
+					int running{};
+					curl_multi_perform(this->multi_, &running);
+
+					int remaining{};
+					while (auto* message = curl_multi_info_read(this->multi_, &remaining))
+					{
+						if (message->msg != CURLMSG_DONE)
+						{
+							continue;
+						}
+
+						const auto entry = this->active_.find(message->easy_handle);
+						if (entry != this->active_.end())
+						{
+							const auto request = entry->second;
+							this->finish(request, message->data.result);
+						}
+					}
+
+					this->controller_.sample(this->active_.size(), this->saturated_);
+
+					// Finished transfers don't wake the poll, queued requests that fit now must not wait for its timeout
+					if (!this->saturated_ || this->active_.size() >= this->controller_.get_limit())
+					{
+						curl_multi_poll(this->multi_, nullptr, 0, 1000, nullptr);
+					}
+				}
+			}
+		};
+
+		// Process-wide state behind all requests: TLS sessions are shared and easy handles are recycled.
+		// Every transfer runs on the engine's multi handle, which already owns one DNS cache and connection pool,
+		// so only the TLS session cache needs sharing for resumed handshakes on new connections.
+		class client
+		{
+		public:
+			client()
+				: share_(curl_share_init())
+			{
+				if (!this->share_)
+				{
+					throw std::runtime_error("Failed to initialize curl share handle");
+				}
+
+				curl_share_setopt(this->share_, CURLSHOPT_LOCKFUNC, lock_callback);
+				curl_share_setopt(this->share_, CURLSHOPT_UNLOCKFUNC, unlock_callback);
+				curl_share_setopt(this->share_, CURLSHOPT_USERDATA, this);
+				curl_share_setopt(this->share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+			}
+
+			~client()
+			{
+				this->idle_handles_.access([](std::vector<CURL*>& handles)
+				{
+					for (auto* handle : handles)
+					{
+						curl_easy_cleanup(handle);
+					}
+
+					handles.clear();
+				});
+
+				curl_share_cleanup(this->share_);
+			}
+
+			client(client&&) = delete;
+			client(const client&) = delete;
+			client& operator=(client&&) = delete;
+			client& operator=(const client&) = delete;
+
+			CURL* acquire()
+			{
+				auto* handle = this->idle_handles_.access<CURL*>([](std::vector<CURL*>& handles) -> CURL*
+				{
+					if (handles.empty())
+					{
+						return nullptr;
+					}
+
+					auto* idle_handle = handles.back();
+					handles.pop_back();
+					return idle_handle;
+				});
+
+				if (!handle)
+				{
+					handle = curl_easy_init();
+				}
+
+				if (handle)
+				{
+					curl_easy_setopt(handle, CURLOPT_SHARE, this->share_);
+					curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 600L);
+				}
+
+				return handle;
+			}
+
+			void release(CURL* handle)
+			{
+				// Resetting keeps the handle's caches, only the options of the finished request are dropped
+				curl_easy_reset(handle);
+
+				const auto recycled = this->idle_handles_.access<bool>([handle](std::vector<CURL*>& handles)
+				{
+					if (handles.size() >= 16)
+					{
+						return false;
+					}
+
+					handles.emplace_back(handle);
+					return true;
+				});
+
+				if (!recycled)
+				{
+					curl_easy_cleanup(handle);
+				}
+			}
+
+			static client& get()
+			{
+				static client instance{};
+				return instance;
+			}
+
+		private:
+			CURLSH* share_{};
+			std::array<std::mutex, CURL_LOCK_DATA_LAST> locks_{};
+			concurrency::container<std::vector<CURL*>> idle_handles_{};
+
+			static void lock_callback(CURL* /*handle*/, const curl_lock_data data, curl_lock_access /*access*/, void* userptr)
+			{
+				static_cast<client*>(userptr)->locks_.at(data).lock();
+			}
+
+			static void unlock_callback(CURL* /*handle*/, const curl_lock_data data, void* userptr)
+			{
+				static_cast<client*>(userptr)->locks_.at(data).unlock();
+			}
+		};
+
+		class string_sink : public data_sink
+		{
+		public:
+			std::string buffer{};
+
+			void reset() override
+			{
+				this->buffer.clear();
+			}
+
+			void write(const char* data, const size_t length) override
+			{
+				this->buffer.append(data, length);
+			}
+		};
+
+		// Runs one attempt on the engine while the calling thread writes the received data to the sink,
+		// which keeps hashing and disk writes off the engine thread
+		std::shared_ptr<transfer> perform(CURL* curl, data_sink& sink, std::uint64_t offset,
+		                                  const std::function<void(size_t)>& callback, const bool decode)
+		{
+			auto request = std::make_shared<transfer>();
+			request->curl = curl;
+
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, request.get());
+			curl_easy_setopt(curl, CURLOPT_HEADERDATA, request.get());
+
+			auto& engine = transfer_engine::get();
+			engine.submit(request);
+
+			bool status_checked = false;
+			std::uint64_t delivered = 0;
+
+			std::unique_ptr<gzip_sink> decoded{};
+			auto* target = &sink;
+
+			while (true)
+			{
+				std::deque<std::string> chunks{};
+				bool done{};
+				bool paused{};
+				long response_code{};
+				std::string content_encoding{};
+
+				{
+					std::unique_lock<std::mutex> lock{request->mutex};
+					request->event.wait_for(lock, std::chrono::milliseconds(100), [&request]()
+					{
+						return !request->chunks.empty() || request->done;
+					});
+
+					chunks = std::move(request->chunks);
+					request->chunks.clear();
+					request->queued_size = 0;
+
+					done = request->done;
+					paused = std::exchange(request->paused, false);
+					response_code = request->response_code;
+					const auto encoding = request->response_headers.find("content-encoding");
+					if (encoding != request->response_headers.end())
+					{
+						content_encoding = string::to_lower(encoding->second);
+					}
+				}
+
+				if (paused)
+				{
+					engine.resume(request);
+				}
+
+				try
+				{
+					for (const auto& chunk : chunks)
+					{
+						if (!status_checked)
+						{
+							status_checked = true;
+
+							// Servers that don't support ranges answer with the full body
+							if (offset > 0 && response_code != 206)
+							{
+								sink.reset();
+								offset = 0;
+							}
+
+							if (decode && (content_encoding == "gzip" || content_encoding == "x-gzip"))
+							{
+								decoded = std::make_unique<gzip_sink>(sink);
+								target = decoded.get();
+							}
+						}
+
+						target->write(chunk.data(), chunk.size());
+						delivered += chunk.size();
+					}
+
+					if (done && decoded && request->result == CURLE_OK)
+					{
+						decoded->finish();
+					}
+
+					// Also called while no data arrives, so the callback can still cancel a stalled transfer
+					if (callback)
+					{
+						callback(static_cast<size_t>(offset + delivered));
+					}
+				}
+				catch (...)
+				{
+					engine.cancel(request);
+
+					std::unique_lock<std::mutex> lock{request->mutex};
+					request->event.wait(lock, [&request]()
+					{
+						return request->done;
+					});
+
+					throw;
+				}
+
+				if (done)
+				{
+					return request;
+				}
+			}
+		}
 	}
 
-	std::optional<std::string> get_data(const std::string& url, const headers& headers,
-	                                    const std::function<void(size_t)>& callback, const uint32_t retries)
+	gzip_sink::gzip_sink(data_sink& sink)
+		: sink_(sink)
+		, decoder_([this](const std::string_view data)
+		{
+			this->sink_.write(data.data(), data.size());
+		})
+	{
+	}
+
+	void gzip_sink::reset()
+	{
+		this->decoder_.reset();
+		this->sink_.reset();
+	}
+
+	void gzip_sink::write(const char* data, const size_t length)
+	{
+		this->decoder_.write(data, length);
+	}
+
+	void gzip_sink::finish()
+	{
+		this->decoder_.finish();
+	}
+
+	bool supports_http2()
+	{
+		const auto* info = curl_version_info(CURLVERSION_NOW);
+		return info && (info->features & CURL_VERSION_HTTP2) != 0;
+	}
+
+	void set_max_concurrent_transfers(const size_t count)
+	{
+		transfer_engine::get().set_max_transfers(count);
+	}
+
+	size_t get_max_concurrent_transfers()
+	{
+		return transfer_engine::get().get_max_transfers();
+	}
+
+	bool get_data(const std::string& url, data_sink& sink, const headers& headers,
+	              const std::function<void(size_t)>& callback, const uint32_t retries, response_info* response)
 	{
 		curl_slist* header_list = nullptr;
-		auto* curl = curl_easy_init();
+		auto& shared_client = client::get();
+		auto* curl = shared_client.acquire();
 		if (!curl)
 		{
-			return {};
+			return false;
 		}
 
+		curl_slist* encoded_header_list = nullptr;
+
 		auto _ = gsl::finally([&]()
 		{
+			shared_client.release(curl);
 			curl_slist_free_all(header_list);
-			curl_easy_cleanup(curl);
+			curl_slist_free_all(encoded_header_list);
 		});
 
+		// Compressed bodies can't continue a range of the plain file, so only full requests accept them.
+		// A caller that negotiates the encoding itself gets the body exactly as it was sent.
+		bool has_range = false;
+		bool has_encoding = false;
+
 		for (const auto& header : headers)
 		{
 			auto data = header.first + ": " + header.second;
 			header_list = curl_slist_append(header_list, data.data());
+			encoded_header_list = curl_slist_append(encoded_header_list, data.data());
+
+			const auto name = string::to_lower(header.first);
+			has_range |= name == "range";
+			has_encoding |= name == "accept-encoding";
 		}
 
-		std::string buffer{};
-		progress_helper helper{};
-		helper.callback = &callback;
+		encoded_header_list = curl_slist_append(encoded_header_list, "Accept-Encoding: gzip");
 
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
 		curl_easy_setopt(curl, CURLOPT_URL, url.data());
 		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-		curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
-		curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &helper);
-		curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+		curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+		curl_easy_setopt(curl, CURLOPT_HTTP_CONTENT_DECODING, 0L);
 		curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+		curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+		curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
 		curl_easy_setopt(curl, CURLOPT_USERAGENT, "xlabs-updater/1.0");
 		curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
 		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
@@ -86,36 +789,105 @@ namespace utils::http
 
 		for (auto i = 0u; i < retries + 1; ++i)
 		{
-			// Due to CURLOPT_FAILONERROR, CURLE_OK will not be met when the server returns 400 or 500
-			if (curl_easy_perform(curl) == CURLE_OK)
+			// Continue after the bytes the sink already holds, from an earlier attempt or an earlier launch
+			const auto offset = sink.get_resume_offset();
+			if (i > 0 && offset == 0)
 			{
-				long http_code = 0;
-				curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+				sink.reset();
+			}
 
-				if (http_code >= 200)
+			const auto range = std::to_string(offset) + "-";
+			curl_easy_setopt(curl, CURLOPT_RANGE, offset > 0 ? range.data() : nullptr);
+			const auto plain = offset > 0 || has_range || has_encoding;
+			curl_easy_setopt(curl, CURLOPT_HTTPHEADER, plain ? header_list : encoded_header_list);
+
+			const auto request = perform(curl, sink, offset, callback, !has_encoding);
+
+			// Due to CURLOPT_FAILONERROR, CURLE_OK will not be met when the server returns 400 or 500
+			if (request->result == CURLE_OK)
+			{
+				if (request->response_code >= 200)
 				{
-					return {std::move(buffer)};
+					if (response)
+					{
+						response->status_code = request->response_code;
+						response->response_headers = std::move(request->response_headers);
+					}
+
+					return true;
 				}
 
 				throw std::runtime_error(
-					"Bad status code " + std::to_string(http_code) + " met while trying to download file " + url);
+					"Bad status code " + std::to_string(request->response_code) + " met while trying to download file " + url);
 			}
 
-			if (helper.exception)
+			// The partial data doesn't fit the file anymore, start over
+			if (request->response_code == 416 && offset > 0)
 			{
-				std::rethrow_exception(helper.exception);
+				sink.reset();
+				continue;
 			}
 
-			long http_code = 0;
-			curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-			if (http_code > 0)
+			if (request->response_code > 0)
 			{
 				break;
 			}
 		}
 
-		return {};
+		return false;
+	}
+
+	std::optional<std::string> get_data(const std::string& url, const headers& headers,
+	                                    const std::function<void(size_t)>& callback, const uint32_t retries,
+	                                    response_info* response)
+	{
+		string_sink sink{};
+		if (!get_data(url, sink, headers, callback, retries, response))
+		{
+			return {};
+		}
+
+		return {std::move(sink.buffer)};
+	}
+
+	file_sink::file_sink(std::filesystem::path target, std::string resume_key)
+		: file_(std::move(target), std::move(resume_key))
+	{
+	}
+
+	void file_sink::reset()
+	{
+		this->file_.truncate();
+	}
+
+	void file_sink::write(const char* data, const size_t length)
+	{
+		this->file_.write(data, length);
+	}
+
+	std::uint64_t file_sink::get_resume_offset() const
+	{
+		return this->file_.get_size();
+	}
+
+	void file_sink::commit()
+	{
+		this->file_.commit();
+	}
+
+	void file_sink::read_contents(const std::function<void(std::string_view)>& callback)
+	{
+		this->file_.read_contents(callback);
+	}
+
+	std::uint64_t file_sink::get_size() const
+	{
+		return this->file_.get_size();
+	}
+
+	std::uint64_t file_sink::get_resumed_size() const
+	{
+		return this->file_.get_resumed_size();
 	}
 
 	std::future<std::optional<std::string>> get_data_async(const std::string& url, const headers& headers)
@@ -4,10 +4,85 @@
 #include <optional>
 #include <future>
 
+#include "io.hpp"
+#include "compression.hpp"
+
 namespace utils::http
 {
 	using headers = std::unordered_map<std::string, std::string>;
 
-	std::optional<std::string> get_data(const std::string& url, const headers& headers = {}, const std::function<void(size_t)>& callback = {}, uint32_t retries = 2);
+	// Receives the response body chunk by chunk while it is downloaded
+	class data_sink
+	{
+	public:
+		virtual ~data_sink() = default;
+
+		// Called when a retry restarts the transfer, everything written so far must be discarded
+		virtual void reset() = 0;
+		virtual void write(const char* data, size_t length) = 0;
+
+		// Bytes the sink already holds, a non-zero offset continues the transfer with a range request instead
+		virtual std::uint64_t get_resume_offset() const
+		{
+			return 0;
+		}
+	};
+
+	// Streams the body into a temporary file next to the target instead of keeping it in memory
+	// A resume key keeps the partial file across retries and launches, see io::atomic_file
+	class file_sink : public data_sink
+	{
+	public:
+		file_sink(std::filesystem::path target, std::string resume_key = {});
+
+		void reset() override;
+		void write(const char* data, size_t length) override;
+		std::uint64_t get_resume_offset() const override;
+
+		void commit();
+		void read_contents(const std::function<void(std::string_view)>& callback);
+
+		[[nodiscard]] std::uint64_t get_size() const;
+		[[nodiscard]] std::uint64_t get_resumed_size() const;
+
+	private:
+		io::atomic_file file_;
+	};
+
+	// Decodes a gzip body while it arrives and passes the plain data on to another sink
+	class gzip_sink : public data_sink
+	{
+	public:
+		gzip_sink(data_sink& sink);
+
+		void reset() override;
+		void write(const char* data, size_t length) override;
+
+		// Throws if the body ended before the gzip stream did
+		void finish();
+
+	private:
+		data_sink& sink_;
+		compression::gzip_decoder decoder_;
+	};
+
+	// HTTP/2 is negotiated through ALPN, this tells whether curl was built with support for it
+	[[nodiscard]] bool supports_http2();
+
+	// Transfers are driven by a single engine thread, which adapts how many of them run at once to the measured
+	// throughput and error rate, this sets the upper bound
+	void set_max_concurrent_transfers(size_t count);
+	[[nodiscard]] size_t get_max_concurrent_transfers();
+
+	// Status and headers of the final response, header names are lower case
+	struct response_info
+	{
+		long status_code{};
+		headers response_headers{};
+	};
+
+	// Gzip transport encoding is accepted and decoded unless the headers contain an Accept-Encoding of their own
+	bool get_data(const std::string& url, data_sink& sink, const headers& headers = {}, const std::function<void(size_t)>& callback = {}, uint32_t retries = 2, response_info* response = nullptr);
+	std::optional<std::string> get_data(const std::string& url, const headers& headers = {}, const std::function<void(size_t)>& callback = {}, uint32_t retries = 2, response_info* response = nullptr);
 	std::future<std::optional<std::string>> get_data_async(const std::string& url, const headers& headers = {});
 }
@@ -1,7 +1,15 @@
 #include "io.hpp"
 #include "nt.hpp"
 
+#include <gsl/gsl>
+
 #include <fstream>
+#include <charconv>
+#include <algorithm>
+
+// Entries are handed to the consumer in batches, which is also how often a walking thread checks for a stop
+#define DIRECTORY_WALK_BATCH_SIZE 256
+#define DIRECTORY_WALK_MAX_THREADS 8
 
 namespace utils::io
 {
@@ -10,9 +18,10 @@ namespace utils::io
 		return DeleteFileW(file.wstring().data()) == TRUE;
 	}
 
-	bool move_file(const std::filesystem::path& src, const std::filesystem::path& target)
+	bool move_file(const std::filesystem::path& src, const std::filesystem::path& target, const bool replace_existing)
 	{
-		return MoveFileW(src.wstring().data(), target.wstring().data()) == TRUE;
+		const DWORD flags = replace_existing ? (MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) : 0;
+		return MoveFileExW(src.wstring().data(), target.wstring().data(), flags) == TRUE;
 	}
 
 	bool file_exists(const std::wstring& file)
@@ -53,22 +62,19 @@ namespace utils::io
 		if (!data) return false;
 		data->clear();
 
-		if (file_exists(file))
-		{
-			std::ifstream stream(file, std::ios::binary);
-			if (!stream.is_open()) return false;
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream.is_open()) return false;
 
-			stream.seekg(0, std::ios::end);
-			const std::streamsize size = stream.tellg();
-			stream.seekg(0, std::ios::beg);
+		stream.seekg(0, std::ios::end);
+		const std::streamsize size = stream.tellg();
+		stream.seekg(0, std::ios::beg);
 
-			if (size > -1)
-			{
-				data->resize(static_cast<uint32_t>(size));
-				stream.read(data->data(), size);
-				stream.close();
-				return true;
-			}
+		if (size > -1)
+		{
+			data->resize(static_cast<size_t>(size));
+			stream.read(data->data(), size);
+			stream.close();
+			return true;
 		}
 
 		return false;
@@ -76,18 +82,41 @@ namespace utils::io
 
 	std::size_t file_size(const std::wstring& file)
 	{
-		if (file_exists(file))
+		WIN32_FILE_ATTRIBUTE_DATA data{};
+		if (!GetFileAttributesExW(file.data(), GetFileExInfoStandard, &data))
 		{
-			std::ifstream stream(file, std::ios::binary);
+			return 0;
+		}
 
-			if (stream.good())
-			{
-				stream.seekg(0, std::ios::end);
-				return static_cast<std::size_t>(stream.tellg());
-			}
+		return static_cast<std::size_t>((static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+	}
+
+	std::optional<file_metadata> get_file_metadata(const std::filesystem::path& file)
+	{
+		// Opening without access rights only requires the file to exist and works while it is in use
+		auto* const handle = CreateFileW(file.wstring().data(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		                                 nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return {};
 		}
 
-		return 0;
+		BY_HANDLE_FILE_INFORMATION info{};
+		const auto result = GetFileInformationByHandle(handle, &info);
+		CloseHandle(handle);
+
+		if (!result || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return {};
+		}
+
+		file_metadata metadata{};
+		metadata.size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+		metadata.last_write_time = (static_cast<std::uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+		metadata.file_id = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+		metadata.volume_serial = info.dwVolumeSerialNumber;
+
+		return {metadata};
 	}
 
 	bool create_directory(const std::filesystem::path& directory)
@@ -109,28 +138,731 @@ namespace utils::io
 	{
 		std::vector<std::wstring> files;
 
-		if (recursive)
+		directory_walker walker{directory, recursive};
+		for (const auto& entry : walker)
+		{
+			files.push_back(entry.path.generic_wstring());
+		}
+
+		return files;
+	}
+
+	void copy_folder(const std::filesystem::path& src, const std::filesystem::path& target)
+	{
+		std::filesystem::copy(src, target,
+		                      std::filesystem::copy_options::overwrite_existing |
+		                      std::filesystem::copy_options::recursive);
+	}
+
+	atomic_file::atomic_file(std::filesystem::path target, std::string resume_key)
+		: target_(std::move(target))
+		, temp_file_(target_)
+		, state_file_(target_)
+		, resume_key_(std::move(resume_key))
+	{
+		this->temp_file_ += ".part";
+		this->state_file_ += ".part.state";
+
+		if (this->target_.has_parent_path())
+		{
+			std::error_code code{};
+			std::filesystem::create_directories(this->target_.parent_path(), code);
+		}
+
+		if (!this->resume_key_.empty() && this->try_resume())
 		{
-			for (auto& file : std::filesystem::recursive_directory_iterator(directory))
+			this->buffer_.reserve(1024 * 1024);
+			return;
+		}
+
+		remove_file(this->state_file_);
+
+		auto* const handle = CreateFileW(this->temp_file_.wstring().data(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		                                 CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Failed to create: " + this->temp_file_.string());
+		}
+
+		this->handle_ = handle;
+		this->buffer_.reserve(1024 * 1024);
+	}
+
+	atomic_file::~atomic_file()
+	{
+		if (!this->handle_)
+		{
+			return;
+		}
+
+		// Keep what was written so far, the state file tells the next instance where to continue
+		if (!this->resume_key_.empty() && this->size_ > 0)
+		{
+			try
+			{
+				this->checkpoint();
+				this->close();
+				return;
+			}
+			catch (...)
 			{
-				files.push_back(file.path().generic_wstring());
+			}
+		}
+
+		this->close();
+		remove_file(this->temp_file_);
+		remove_file(this->state_file_);
+	}
+
+	void atomic_file::write(const char* data, const size_t length)
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
+		}
+
+		// Small network chunks are collected, so the disk sees few large writes
+		if (this->buffer_.size() + length > this->buffer_.capacity())
+		{
+			this->flush_buffer();
+		}
+
+		if (length >= this->buffer_.capacity())
+		{
+			auto* current = data;
+			auto remaining = length;
+
+			while (remaining > 0)
+			{
+				DWORD written{};
+				const auto chunk = static_cast<DWORD>(std::min(remaining, static_cast<size_t>(0x40000000)));
+				if (!WriteFile(this->handle_, current, chunk, &written, nullptr) || written != chunk)
+				{
+					throw std::runtime_error("Failed to write: " + this->temp_file_.string());
+				}
+
+				current += chunk;
+				remaining -= chunk;
 			}
 		}
 		else
 		{
-			for (auto& file : std::filesystem::directory_iterator(directory))
+			this->buffer_.append(data, length);
+		}
+
+		this->size_ += length;
+
+		if (!this->resume_key_.empty() && this->size_ - this->checkpoint_size_ >= 16 * 1024 * 1024)
+		{
+			this->checkpoint();
+		}
+	}
+
+	void atomic_file::truncate()
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
+		}
+
+		this->buffer_.clear();
+		this->size_ = 0;
+		this->resumed_size_ = 0;
+		this->checkpoint_size_ = 0;
+
+		remove_file(this->state_file_);
+
+		LARGE_INTEGER position{};
+		if (!SetFilePointerEx(this->handle_, position, nullptr, FILE_BEGIN) || !SetEndOfFile(this->handle_))
+		{
+			throw std::runtime_error("Failed to truncate: " + this->temp_file_.string());
+		}
+	}
+
+	void atomic_file::commit()
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
+		}
+
+		this->flush_buffer();
+
+		// The data must be on disk before the rename becomes visible, otherwise a crash could leave a torn target
+		const auto flushed = FlushFileBuffers(this->handle_);
+		this->close();
+
+		if (!flushed || !move_file(this->temp_file_, this->target_, true))
+		{
+			remove_file(this->temp_file_);
+			remove_file(this->state_file_);
+			throw std::runtime_error("Failed to write: " + this->target_.string());
+		}
+
+		remove_file(this->state_file_);
+	}
+
+	void atomic_file::allocate(const std::uint64_t size)
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
+		}
+
+		this->flush_buffer();
+
+		LARGE_INTEGER position{};
+		position.QuadPart = static_cast<LONGLONG>(size);
+		if (!SetFilePointerEx(this->handle_, position, nullptr, FILE_BEGIN) || !SetEndOfFile(this->handle_))
+		{
+			throw std::runtime_error("Failed to allocate: " + this->temp_file_.string());
+		}
+
+		this->size_ = size;
+	}
+
+	void atomic_file::write_at(const std::uint64_t offset, const char* data, const size_t length)
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
+		}
+
+		if (offset > this->size_ || length > this->size_ - offset)
+		{
+			throw std::runtime_error("Write exceeds allocated size: " + this->temp_file_.string());
+		}
+
+		auto position = offset;
+		auto* current = data;
+		auto remaining = length;
+
+		while (remaining > 0)
+		{
+			// The offset travels with the request, so concurrent writers don't race on the file pointer
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(position);
+			overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+			DWORD written{};
+			const auto chunk = static_cast<DWORD>(std::min(remaining, static_cast<size_t>(0x40000000)));
+			if (!WriteFile(this->handle_, current, chunk, &written, &overlapped) || written != chunk)
 			{
-				files.push_back(file.path().generic_wstring());
+				throw std::runtime_error("Failed to write: " + this->temp_file_.string());
 			}
+
+			position += chunk;
+			current += chunk;
+			remaining -= chunk;
+		}
+	}
+
+	void atomic_file::read_contents(const std::function<void(std::string_view)>& callback)
+	{
+		if (!this->handle_)
+		{
+			throw std::runtime_error("File was already committed: " + this->target_.string());
 		}
 
-		return files;
+		this->flush_buffer();
+
+		LARGE_INTEGER position{};
+		if (!SetFilePointerEx(this->handle_, position, nullptr, FILE_BEGIN))
+		{
+			throw std::runtime_error("Failed to read: " + this->temp_file_.string());
+		}
+
+		std::string chunk{};
+		chunk.resize(1024 * 1024);
+
+		auto remaining = this->size_;
+		while (remaining > 0)
+		{
+			DWORD bytes_read{};
+			const auto length = static_cast<DWORD>(std::min(remaining, static_cast<std::uint64_t>(chunk.size())));
+			if (!ReadFile(this->handle_, chunk.data(), length, &bytes_read, nullptr) || bytes_read != length)
+			{
+				throw std::runtime_error("Failed to read: " + this->temp_file_.string());
+			}
+
+			callback(std::string_view(chunk.data(), bytes_read));
+			remaining -= bytes_read;
+		}
+
+		if (!SetFilePointerEx(this->handle_, position, nullptr, FILE_END))
+		{
+			throw std::runtime_error("Failed to read: " + this->temp_file_.string());
+		}
 	}
 
-	void copy_folder(const std::filesystem::path& src, const std::filesystem::path& target)
+	std::uint64_t atomic_file::get_size() const
 	{
-		std::filesystem::copy(src, target,
-		                      std::filesystem::copy_options::overwrite_existing |
-		                      std::filesystem::copy_options::recursive);
+		return this->size_;
+	}
+
+	std::uint64_t atomic_file::get_resumed_size() const
+	{
+		return this->resumed_size_;
+	}
+
+	const std::filesystem::path& atomic_file::get_target() const
+	{
+		return this->target_;
+	}
+
+	bool atomic_file::try_resume()
+	{
+		std::string state{};
+		if (!read_file(this->state_file_.wstring(), &state))
+		{
+			return false;
+		}
+
+		const auto separator = state.find('\n');
+		if (separator == std::string::npos || std::string_view(state).substr(0, separator) != this->resume_key_)
+		{
+			return false;
+		}
+
+		std::uint64_t size{};
+		const auto* const end = state.data() + state.size();
+		const auto result = std::from_chars(state.data() + separator + 1, end, size);
+		if (result.ec != std::errc{} || result.ptr != end || size == 0)
+		{
+			return false;
+		}
+
+		auto* const handle = CreateFileW(this->temp_file_.wstring().data(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+		                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		// Anything past the recorded size was not flushed when the state was written and can't be trusted
+		LARGE_INTEGER file_size{};
+		LARGE_INTEGER position{};
+		position.QuadPart = static_cast<LONGLONG>(size);
+
+		if (!GetFileSizeEx(handle, &file_size) || static_cast<std::uint64_t>(file_size.QuadPart) < size
+			|| !SetFilePointerEx(handle, position, nullptr, FILE_BEGIN) || !SetEndOfFile(handle))
+		{
+			CloseHandle(handle);
+			return false;
+		}
+
+		this->handle_ = handle;
+		this->size_ = size;
+		this->resumed_size_ = size;
+		this->checkpoint_size_ = size;
+		return true;
+	}
+
+	void atomic_file::checkpoint()
+	{
+		this->flush_buffer();
+
+		// The state must never claim more than what is durably on disk
+		if (!FlushFileBuffers(this->handle_)
+			|| !write_file(this->state_file_.wstring(), this->resume_key_ + "\n" + std::to_string(this->size_)))
+		{
+			throw std::runtime_error("Failed to write: " + this->state_file_.string());
+		}
+
+		this->checkpoint_size_ = this->size_;
+	}
+
+	void atomic_file::flush_buffer()
+	{
+		if (this->buffer_.empty())
+		{
+			return;
+		}
+
+		DWORD written{};
+		if (!WriteFile(this->handle_, this->buffer_.data(), static_cast<DWORD>(this->buffer_.size()), &written, nullptr)
+			|| written != this->buffer_.size())
+		{
+			throw std::runtime_error("Failed to write: " + this->temp_file_.string());
+		}
+
+		this->buffer_.clear();
+	}
+
+	void atomic_file::close()
+	{
+		if (this->handle_)
+		{
+			CloseHandle(this->handle_);
+			this->handle_ = nullptr;
+		}
+	}
+
+	mapped_file::mapped_file(const std::filesystem::path& file)
+	{
+		// Writers are locked out while the file is mapped, truncating it would fault on access
+		auto* const handle = CreateFileW(file.wstring().data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		this->file_handle_ = handle;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(handle, &size))
+		{
+			this->close();
+			return;
+		}
+
+		this->size_ = static_cast<std::uint64_t>(size.QuadPart);
+
+		// Empty files can't be mapped, but are still valid
+		if (this->size_ == 0)
+		{
+			return;
+		}
+
+		this->mapping_handle_ = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!this->mapping_handle_)
+		{
+			this->close();
+		}
+	}
+
+	mapped_file::~mapped_file()
+	{
+		this->close();
+	}
+
+	mapped_file::operator bool() const
+	{
+		return this->file_handle_ != nullptr;
+	}
+
+	std::uint64_t mapped_file::get_size() const
+	{
+		return this->size_;
+	}
+
+	std::string_view mapped_file::map(const std::uint64_t offset, size_t length)
+	{
+		this->unmap();
+
+		if (!this->mapping_handle_ || offset >= this->size_)
+		{
+			return {};
+		}
+
+		length = static_cast<size_t>(std::min(static_cast<std::uint64_t>(length), this->size_ - offset));
+
+		// The offset has to be aligned to the allocation granularity, so the view might start a bit earlier
+		SYSTEM_INFO info{};
+		GetSystemInfo(&info);
+
+		const auto aligned_offset = offset - (offset % info.dwAllocationGranularity);
+		const auto delta = static_cast<size_t>(offset - aligned_offset);
+
+		this->view_ = MapViewOfFile(this->mapping_handle_, FILE_MAP_READ, static_cast<DWORD>(aligned_offset >> 32),
+		                            static_cast<DWORD>(aligned_offset & 0xFFFFFFFF), length + delta);
+		if (!this->view_)
+		{
+			return {};
+		}
+
+		return {static_cast<const char*>(this->view_) + delta, length};
+	}
+
+	bool mapped_file::for_each_window(const std::function<void(std::string_view)>& callback, const size_t window_size)
+	{
+		for (std::uint64_t offset = 0; offset < this->size_; offset += window_size)
+		{
+			const auto view = this->map(offset, window_size);
+			if (view.empty())
+			{
+				return false;
+			}
+
+			callback(view);
+		}
+
+		this->unmap();
+		return *this;
+	}
+
+	void mapped_file::unmap()
+	{
+		if (this->view_)
+		{
+			UnmapViewOfFile(this->view_);
+			this->view_ = nullptr;
+		}
+	}
+
+	void mapped_file::close()
+	{
+		this->unmap();
+
+		if (this->mapping_handle_)
+		{
+			CloseHandle(this->mapping_handle_);
+			this->mapping_handle_ = nullptr;
+		}
+
+		if (this->file_handle_)
+		{
+			CloseHandle(this->file_handle_);
+			this->file_handle_ = nullptr;
+		}
+	}
+
+	directory_walker::iterator::iterator(directory_walker& walker)
+		: walker_(&walker)
+	{
+		++*this;
+	}
+
+	const directory_entry& directory_walker::iterator::operator*() const
+	{
+		return this->entry_;
+	}
+
+	const directory_entry* directory_walker::iterator::operator->() const
+	{
+		return &this->entry_;
+	}
+
+	directory_walker::iterator& directory_walker::iterator::operator++()
+	{
+		auto entry = this->walker_->next();
+		if (entry)
+		{
+			this->entry_ = std::move(*entry);
+		}
+		else
+		{
+			this->walker_ = nullptr;
+		}
+
+		return *this;
+	}
+
+	void directory_walker::iterator::operator++(int)
+	{
+		++*this;
+	}
+
+	bool directory_walker::iterator::operator==(std::default_sentinel_t) const
+	{
+		return !this->walker_;
+	}
+
+	directory_walker::directory_walker(const std::filesystem::path& directory, const bool recursive,
+	                                   std::function<bool(const directory_entry&)> descend)
+		: recursive_(recursive)
+		, descend_(std::move(descend))
+	{
+		this->state_.access([&directory](walk_state& state)
+		{
+			state.directories.emplace_back(directory);
+		});
+
+		// Enumeration mostly waits on the file system, so more threads than cores can still pay off on slow drives
+		const auto thread_count = recursive ? std::clamp<unsigned>(std::thread::hardware_concurrency(), 1, DIRECTORY_WALK_MAX_THREADS) : 1u;
+
+		for (auto i = 0u; i < thread_count; ++i)
+		{
+			this->threads_.emplace_back([this]()
+			{
+				this->work();
+			});
+		}
+	}
+
+	directory_walker::~directory_walker()
+	{
+		this->state_.access([](walk_state& state)
+		{
+			state.stopped = true;
+		});
+
+		this->directory_event_.notify_all();
+		this->entry_event_.notify_all();
+
+		for (auto& thread : this->threads_)
+		{
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+	}
+
+	directory_walker::iterator directory_walker::begin()
+	{
+		return {*this};
+	}
+
+	std::default_sentinel_t directory_walker::end() const
+	{
+		return {};
+	}
+
+	std::optional<directory_entry> directory_walker::next()
+	{
+		return this->state_.access_with_lock<std::optional<directory_entry>>(
+			[this](walk_state& state, std::unique_lock<std::mutex>& lock) -> std::optional<directory_entry>
+			{
+				this->entry_event_.wait(lock, [&state]()
+				{
+					return !state.entries.empty() || state.stopped || state.is_done();
+				});
+
+				if (state.entries.empty())
+				{
+					return {};
+				}
+
+				auto entry = std::move(state.entries.front());
+				state.entries.pop_front();
+				return {std::move(entry)};
+			});
+	}
+
+	bool directory_walker::walk_state::is_done() const
+	{
+		return this->directories.empty() && this->active_directories == 0;
+	}
+
+	void directory_walker::work()
+	{
+		while (true)
+		{
+			std::filesystem::path directory{};
+
+			const auto has_work = this->state_.access_with_lock<bool>([&](walk_state& state, std::unique_lock<std::mutex>& lock)
+			{
+				// An empty queue only means the end of the walk once no other thread can add to it anymore
+				this->directory_event_.wait(lock, [&state]()
+				{
+					return state.stopped || !state.directories.empty() || state.active_directories == 0;
+				});
+
+				if (state.stopped || state.directories.empty())
+				{
+					return false;
+				}
+
+				directory = std::move(state.directories.front());
+				state.directories.pop_front();
+				++state.active_directories;
+				return true;
+			});
+
+			if (!has_work)
+			{
+				return;
+			}
+
+			this->enumerate(directory);
+
+			const auto done = this->state_.access<bool>([](walk_state& state)
+			{
+				--state.active_directories;
+				return state.is_done();
+			});
+
+			if (done)
+			{
+				this->directory_event_.notify_all();
+				this->entry_event_.notify_all();
+			}
+		}
+	}
+
+	void directory_walker::enumerate(const std::filesystem::path& directory)
+	{
+		// Basic info skips the short names and large fetch lets every call return as many entries as fit its buffer
+		WIN32_FIND_DATAW data{};
+		auto* const handle = FindFirstFileExW((directory / L"*").wstring().data(), FindExInfoBasic, &data,
+		                                      FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		const auto _ = gsl::finally([handle]()
+		{
+			FindClose(handle);
+		});
+
+		std::vector<directory_entry> entries{};
+		std::vector<std::filesystem::path> directories{};
+
+		do
+		{
+			const std::wstring_view name = data.cFileName;
+			if (name == L"." || name == L"..")
+			{
+				continue;
+			}
+
+			directory_entry entry{};
+			entry.path = directory / name;
+			entry.is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+			entry.size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+			entry.last_write_time = (static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+
+			// Links to other directories are reported, but not followed
+			if (entry.is_directory && this->recursive_ && !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+				&& (!this->descend_ || this->descend_(entry)))
+			{
+				directories.emplace_back(entry.path);
+			}
+
+			entries.emplace_back(std::move(entry));
+
+			if (entries.size() >= DIRECTORY_WALK_BATCH_SIZE && !this->publish(entries, directories))
+			{
+				return;
+			}
+		}
+		while (FindNextFileW(handle, &data));
+
+		this->publish(entries, directories);
+	}
+
+	bool directory_walker::publish(std::vector<directory_entry>& entries, std::vector<std::filesystem::path>& directories)
+	{
+		const auto directory_count = directories.size();
+		const auto entry_count = entries.size();
+
+		const auto stopped = this->state_.access<bool>([&](walk_state& state)
+		{
+			std::ranges::move(directories, std::back_inserter(state.directories));
+			std::ranges::move(entries, std::back_inserter(state.entries));
+			return state.stopped;
+		});
+
+		directories.clear();
+		entries.clear();
+
+		if (directory_count > 1)
+		{
+			this->directory_event_.notify_all();
+		}
+		else if (directory_count == 1)
+		{
+			this->directory_event_.notify_one();
+		}
+
+		if (entry_count > 0)
+		{
+			this->entry_event_.notify_one();
+		}
+
+		return !stopped;
 	}
 }
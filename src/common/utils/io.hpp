@@ -3,19 +3,191 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <optional>
+#include <functional>
+#include <string_view>
+#include <iterator>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+
+#include "concurrency.hpp"
 
 namespace utils::io
 {
+	struct file_metadata
+	{
+		std::uint64_t size{};
+		std::uint64_t last_write_time{};
+		std::uint64_t file_id{};
+		std::uint32_t volume_serial{};
+
+		bool operator==(const file_metadata&) const = default;
+	};
+
 	bool remove_file(const std::filesystem::path& file);
-	bool move_file(const std::filesystem::path& src, const std::filesystem::path& target);
+	bool move_file(const std::filesystem::path& src, const std::filesystem::path& target, bool replace_existing = false);
 	bool file_exists(const std::wstring& file);
 	bool write_file(const std::wstring& file, const std::string& data, bool append = false);
 	bool read_file(const std::wstring& file, std::string* data);
 	std::string read_file(const std::wstring& file);
 	std::size_t file_size(const std::wstring& file);
+	std::optional<file_metadata> get_file_metadata(const std::filesystem::path& file);
 	bool create_directory(const std::filesystem::path& directory);
 	bool directory_exists(const std::filesystem::path& directory);
 	bool directory_is_empty(const std::filesystem::path& directory);
 	std::vector<std::wstring> list_files(const std::filesystem::path& directory, bool recursive = false);
 	void copy_folder(const std::filesystem::path& src, const std::filesystem::path& target);
+
+	// Writes into a temporary file next to the target, which only replaces the target once committed
+	// With a resume key, an uncommitted temporary file is kept together with a state file recording how much of it
+	// reached the disk, so that a later instance using the same key continues from there instead of starting over
+	class atomic_file
+	{
+	public:
+		atomic_file(std::filesystem::path target, std::string resume_key = {});
+		~atomic_file();
+
+		atomic_file(atomic_file&&) = delete;
+		atomic_file(const atomic_file&) = delete;
+		atomic_file& operator=(atomic_file&&) = delete;
+		atomic_file& operator=(const atomic_file&) = delete;
+
+		void write(const char* data, size_t length);
+		void truncate();
+		void commit();
+
+		// Sets the final size up front, so that several threads can fill it with positioned writes in any order
+		void allocate(std::uint64_t size);
+		void write_at(std::uint64_t offset, const char* data, size_t length);
+
+		// Reads back what is already in the temporary file, e.g. a prefix that was resumed
+		void read_contents(const std::function<void(std::string_view)>& callback);
+
+		[[nodiscard]] std::uint64_t get_size() const;
+		[[nodiscard]] std::uint64_t get_resumed_size() const;
+		[[nodiscard]] const std::filesystem::path& get_target() const;
+
+	private:
+		std::filesystem::path target_;
+		std::filesystem::path temp_file_;
+		std::filesystem::path state_file_;
+		std::string resume_key_;
+		void* handle_{};
+		std::uint64_t size_{};
+		std::uint64_t resumed_size_{};
+		std::uint64_t checkpoint_size_{};
+		std::string buffer_{};
+
+		bool try_resume();
+		void checkpoint();
+		void flush_buffer();
+		void close();
+	};
+
+	// Read-only memory mapping of a file, which allows hashing or parsing it without copying it to the heap
+	class mapped_file
+	{
+	public:
+		mapped_file(const std::filesystem::path& file);
+		~mapped_file();
+
+		mapped_file(mapped_file&&) = delete;
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(mapped_file&&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		operator bool() const;
+
+		[[nodiscard]] std::uint64_t get_size() const;
+
+		// The returned view stays valid until the next call or until the file is destroyed
+		std::string_view map(std::uint64_t offset, size_t length);
+		bool for_each_window(const std::function<void(std::string_view)>& callback, size_t window_size = 64 * 1024 * 1024);
+
+	private:
+		void* file_handle_{};
+		void* mapping_handle_{};
+		void* view_{};
+		std::uint64_t size_{};
+
+		void unmap();
+		void close();
+	};
+
+	// Entry as reported by the directory enumeration itself, using it needs no further access to the file
+	struct directory_entry
+	{
+		std::filesystem::path path{};
+		bool is_directory{};
+		std::uint64_t size{};
+		std::uint64_t last_write_time{};
+	};
+
+	// Walks a directory tree on several threads, each directory is enumerated in large batches by one of them.
+	// Iterating the walker yields entries in no particular order while the walk is still running.
+	// The descend callback decides which subdirectories are walked, it is called on the walking threads.
+	class directory_walker
+	{
+	public:
+		class iterator
+		{
+		public:
+			using value_type = directory_entry;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+			iterator(directory_walker& walker);
+
+			const directory_entry& operator*() const;
+			const directory_entry* operator->() const;
+
+			iterator& operator++();
+			void operator++(int);
+
+			bool operator==(std::default_sentinel_t) const;
+
+		private:
+			directory_walker* walker_{};
+			directory_entry entry_{};
+		};
+
+		directory_walker(const std::filesystem::path& directory, bool recursive = true,
+		                 std::function<bool(const directory_entry&)> descend = {});
+		~directory_walker();
+
+		directory_walker(directory_walker&&) = delete;
+		directory_walker(const directory_walker&) = delete;
+		directory_walker& operator=(directory_walker&&) = delete;
+		directory_walker& operator=(const directory_walker&) = delete;
+
+		iterator begin();
+		std::default_sentinel_t end() const;
+
+		// Blocks until the next entry is found, returns nothing once the walk is complete
+		std::optional<directory_entry> next();
+
+	private:
+		struct walk_state
+		{
+			std::deque<std::filesystem::path> directories{};
+			std::deque<directory_entry> entries{};
+			size_t active_directories{};
+			bool stopped{};
+
+			[[nodiscard]] bool is_done() const;
+		};
+
+		bool recursive_{};
+		std::function<bool(const directory_entry&)> descend_{};
+
+		concurrency::container<walk_state> state_{};
+		std::condition_variable directory_event_{};
+		std::condition_variable entry_event_{};
+		std::vector<std::thread> threads_{};
+
+		void work();
+		void enumerate(const std::filesystem::path& directory);
+		bool publish(std::vector<directory_entry>& entries, std::vector<std::filesystem::path>& directories);
+	};
 }
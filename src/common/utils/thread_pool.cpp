@@ -0,0 +1,196 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace utils
+{
+	namespace
+	{
+		struct parallel_for_state
+		{
+			std::mutex mutex{};
+			std::condition_variable condition{};
+
+			bool closed{false};
+			size_t active_helpers{0};
+
+			std::atomic<size_t> current_index{0};
+			std::exception_ptr exception{};
+		};
+
+		void run_parallel_for(parallel_for_state& state, const size_t count, const std::function<void(size_t)>& callback)
+		{
+			while (true)
+			{
+				{
+					std::lock_guard<std::mutex> _{state.mutex};
+					if (state.exception)
+					{
+						return;
+					}
+				}
+
+				const auto index = state.current_index++;
+				if (index >= count)
+				{
+					return;
+				}
+
+				try
+				{
+					callback(index);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> _{state.mutex};
+					if (!state.exception)
+					{
+						state.exception = std::current_exception();
+					}
+
+					return;
+				}
+			}
+		}
+	}
+
+	thread_pool::thread_pool(const size_t thread_count)
+	{
+		const auto count = std::max(static_cast<size_t>(1), thread_count);
+		this->threads_.reserve(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			this->threads_.emplace_back([this]()
+			{
+				this->work();
+			});
+		}
+	}
+
+	thread_pool::~thread_pool()
+	{
+		this->queue_.access([](task_queue& queue)
+		{
+			queue.stopped = true;
+		});
+
+		this->condition_.notify_all();
+
+		for (auto& thread : this->threads_)
+		{
+			if (thread.joinable())
+			{
+				thread.join();
+			}
+		}
+	}
+
+	void thread_pool::post(std::function<void()> task)
+	{
+		this->queue_.access([&task](task_queue& queue)
+		{
+			queue.tasks.emplace(std::move(task));
+		});
+
+		this->condition_.notify_one();
+	}
+
+	void thread_pool::parallel_for(const size_t count, const std::function<void(size_t)>& callback, const size_t max_threads)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		auto thread_count = std::min(count, this->get_thread_count() + 1);
+		if (max_threads)
+		{
+			thread_count = std::min(thread_count, max_threads);
+		}
+
+		// Helpers that only get scheduled after the work is done must not touch the callback anymore,
+		// so the state is shared and the caller only waits for helpers that actually started
+		const auto state = std::make_shared<parallel_for_state>();
+
+		for (size_t i = 1; i < thread_count; ++i)
+		{
+			this->post([state, count, &callback]()
+			{
+				{
+					std::lock_guard<std::mutex> _{state->mutex};
+					if (state->closed)
+					{
+						return;
+					}
+
+					++state->active_helpers;
+				}
+
+				run_parallel_for(*state, count, callback);
+
+				std::lock_guard<std::mutex> _{state->mutex};
+				--state->active_helpers;
+				state->condition.notify_all();
+			});
+		}
+
+		run_parallel_for(*state, count, callback);
+
+		std::unique_lock<std::mutex> lock{state->mutex};
+		state->closed = true;
+		state->condition.wait(lock, [&state]()
+		{
+			return state->active_helpers == 0;
+		});
+
+		if (state->exception)
+		{
+			std::rethrow_exception(state->exception);
+		}
+	}
+
+	size_t thread_pool::get_thread_count() const
+	{
+		return this->threads_.size();
+	}
+
+	thread_pool& thread_pool::get()
+	{
+		static thread_pool pool{};
+		return pool;
+	}
+
+	void thread_pool::work()
+	{
+		while (true)
+		{
+			std::function<void()> task{};
+
+			const auto stopped = this->queue_.access_with_lock<bool>([&](task_queue& queue, std::unique_lock<std::mutex>& lock)
+			{
+				this->condition_.wait(lock, [&queue]()
+				{
+					return queue.stopped || !queue.tasks.empty();
+				});
+
+				if (queue.tasks.empty())
+				{
+					return true;
+				}
+
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop();
+				return false;
+			});
+
+			if (stopped)
+			{
+				return;
+			}
+
+			task();
+		}
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <queue>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include "concurrency.hpp"
+
+namespace utils
+{
+	class thread_pool
+	{
+	public:
+		thread_pool(size_t thread_count = std::thread::hardware_concurrency());
+		~thread_pool();
+
+		thread_pool(thread_pool&&) = delete;
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(thread_pool&&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		void post(std::function<void()> task);
+
+		// Runs the callback for every index in [0, count) and waits for all of them.
+		// The calling thread helps out, so this can safely be nested inside pool tasks.
+		// The first exception stops the remaining indices and is rethrown.
+		void parallel_for(size_t count, const std::function<void(size_t)>& callback, size_t max_threads = 0);
+
+		[[nodiscard]] size_t get_thread_count() const;
+
+		static thread_pool& get();
+
+	private:
+		struct task_queue
+		{
+			bool stopped{false};
+			std::queue<std::function<void()>> tasks{};
+		};
+
+		concurrency::container<task_queue> queue_{};
+		std::condition_variable_any condition_{};
+		std::vector<std::thread> threads_{};
+
+		void work();
+	};
+}
@@ -14,6 +14,9 @@
 
 #include <string>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
 #include <vector>
 #include <functional>
 #include <fstream>
@@ -22,6 +25,7 @@
 #include <atomic>
 #include <set>
 #include <unordered_set>
+#include <unordered_map>
 #include <filesystem>
 
 #include <optional>
@@ -0,0 +1,377 @@
+#include <std_include.hpp>
+
+#include "binary_manifest.hpp"
+
+#define BINARY_MANIFEST_MAGIC "XLBM"
+#define BINARY_MANIFEST_VERSION 1
+
+namespace updater
+{
+	namespace
+	{
+		// All offsets are relative to the start of the data, tables are 8 byte aligned
+		struct manifest_header
+		{
+			char magic[4];
+			std::uint32_t version;
+			std::uint64_t source_size;
+			std::uint32_t record_count;
+			std::uint32_t patch_count;
+			std::uint32_t records_offset;
+			std::uint32_t patches_offset;
+			std::uint32_t index_offset;
+			std::uint32_t strings_offset;
+			std::uint32_t strings_size;
+			std::uint32_t reserved;
+		};
+
+		struct string_ref
+		{
+			std::uint32_t offset;
+			std::uint32_t length;
+		};
+
+		struct manifest_record
+		{
+			string_ref name;
+			string_ref hash;
+			string_ref tree_hash;
+			string_ref codec;
+			std::uint64_t size;
+			std::uint64_t compressed_size;
+			std::uint32_t first_patch;
+			std::uint32_t patch_count;
+		};
+
+		struct manifest_patch
+		{
+			string_ref from_hash;
+			string_ref hash;
+			std::uint64_t size;
+		};
+
+		static_assert(sizeof(manifest_header) == 48);
+		static_assert(sizeof(manifest_record) == 56);
+		static_assert(sizeof(manifest_patch) == 24);
+
+		size_t align(const size_t offset)
+		{
+			return (offset + 7) & ~static_cast<size_t>(7);
+		}
+
+		const manifest_header& get_header(const std::string_view data)
+		{
+			return *reinterpret_cast<const manifest_header*>(data.data());
+		}
+
+		template <typename T>
+		const T* get_table(const std::string_view data, const std::uint32_t offset)
+		{
+			return reinterpret_cast<const T*>(data.data() + offset);
+		}
+
+		std::string_view get_string(const std::string_view data, const string_ref& ref)
+		{
+			return data.substr(get_header(data).strings_offset + ref.offset, ref.length);
+		}
+
+		template <typename T>
+		void write_table(std::string& data, const std::uint32_t offset, const std::vector<T>& table)
+		{
+			// memcpy from the null data of an empty vector is undefined, even for zero bytes
+			if (!table.empty())
+			{
+				std::memcpy(data.data() + offset, table.data(), table.size() * sizeof(T));
+			}
+		}
+
+		bool is_table_valid(const std::string_view data, const std::uint32_t offset, const std::uint64_t count,
+		                    const size_t element_size)
+		{
+			return offset % 8 == 0 && offset <= data.size() && count * element_size <= data.size() - offset;
+		}
+
+		class string_pool
+		{
+		public:
+			string_ref add(const std::string& string)
+			{
+				if (this->data.size() + string.size() > std::numeric_limits<std::uint32_t>::max())
+				{
+					throw std::runtime_error("Manifest string pool is too large");
+				}
+
+				const string_ref ref{static_cast<std::uint32_t>(this->data.size()), static_cast<std::uint32_t>(string.size())};
+				this->data.append(string);
+				return ref;
+			}
+
+			std::string data{};
+		};
+	}
+
+	binary_manifest::binary_manifest(const std::filesystem::path& file)
+		: file_(std::make_unique<utils::io::mapped_file>(file))
+	{
+		if (*this->file_ && this->file_->get_size() <= std::numeric_limits<std::uint32_t>::max())
+		{
+			this->data_ = this->file_->map(0, static_cast<size_t>(this->file_->get_size()));
+		}
+
+		this->validate();
+	}
+
+	binary_manifest::binary_manifest(std::string data)
+		: buffer_(std::move(data))
+		, data_(this->buffer_)
+	{
+		this->validate();
+	}
+
+	binary_manifest::operator bool() const
+	{
+		return !this->data_.empty();
+	}
+
+	size_t binary_manifest::size() const
+	{
+		return this->data_.empty() ? 0 : get_header(this->data_).record_count;
+	}
+
+	std::uint64_t binary_manifest::get_source_size() const
+	{
+		return this->data_.empty() ? 0 : get_header(this->data_).source_size;
+	}
+
+	binary_manifest::entry binary_manifest::get_entry(const size_t index) const
+	{
+		const auto& header = get_header(this->data_);
+		const auto& record = get_table<manifest_record>(this->data_, header.records_offset)[index];
+
+		entry result{};
+		result.name = get_string(this->data_, record.name);
+		result.size = record.size;
+		result.hash = get_string(this->data_, record.hash);
+		result.tree_hash = get_string(this->data_, record.tree_hash);
+		result.codec = get_string(this->data_, record.codec);
+		result.compressed_size = record.compressed_size;
+
+		return result;
+	}
+
+	file_info binary_manifest::get_file_info(const size_t index) const
+	{
+		const auto& header = get_header(this->data_);
+		const auto& record = get_table<manifest_record>(this->data_, header.records_offset)[index];
+		const auto* patches = get_table<manifest_patch>(this->data_, header.patches_offset);
+
+		const auto view = this->get_entry(index);
+
+		file_info info{};
+		info.name = view.name;
+		info.size = static_cast<size_t>(view.size);
+		info.hash = view.hash;
+		info.tree_hash = view.tree_hash;
+		info.codec = view.codec;
+		info.compressed_size = static_cast<size_t>(view.compressed_size);
+
+		info.patches.reserve(record.patch_count);
+
+		for (std::uint32_t i = 0; i < record.patch_count; ++i)
+		{
+			const auto& patch = patches[record.first_patch + i];
+
+			patch_info patch_entry{};
+			patch_entry.from_hash = get_string(this->data_, patch.from_hash);
+			patch_entry.size = static_cast<size_t>(patch.size);
+			patch_entry.hash = get_string(this->data_, patch.hash);
+
+			info.patches.emplace_back(std::move(patch_entry));
+		}
+
+		return info;
+	}
+
+	std::optional<size_t> binary_manifest::find(const std::string_view name) const
+	{
+		const auto index = this->get_index();
+		const auto position = this->lower_bound(name);
+		if (position == index.end() || this->get_name(*position) != name)
+		{
+			return {};
+		}
+
+		return {*position};
+	}
+
+	bool binary_manifest::has_prefix(const std::string_view prefix) const
+	{
+		// Names sharing the prefix directly follow the position the prefix itself would be inserted at
+		const auto position = this->lower_bound(prefix);
+		return position != this->get_index().end() && this->get_name(*position).starts_with(prefix);
+	}
+
+	std::string binary_manifest::build(const std::vector<file_info>& files, const std::uint64_t source_size)
+	{
+		if (files.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::runtime_error("Manifest has too many entries");
+		}
+
+		string_pool strings{};
+		std::vector<manifest_record> records{};
+		std::vector<manifest_patch> patches{};
+
+		records.reserve(files.size());
+
+		for (const auto& file : files)
+		{
+			manifest_record record{};
+			record.name = strings.add(file.name);
+			record.hash = strings.add(file.hash);
+			record.tree_hash = strings.add(file.tree_hash);
+			record.codec = strings.add(file.codec);
+			record.size = file.size;
+			record.compressed_size = file.compressed_size;
+			record.first_patch = static_cast<std::uint32_t>(patches.size());
+			record.patch_count = static_cast<std::uint32_t>(file.patches.size());
+
+			for (const auto& patch : file.patches)
+			{
+				manifest_patch patch_record{};
+				patch_record.from_hash = strings.add(patch.from_hash);
+				patch_record.hash = strings.add(patch.hash);
+				patch_record.size = patch.size;
+
+				patches.emplace_back(patch_record);
+			}
+
+			records.emplace_back(record);
+		}
+
+		std::vector<std::uint32_t> index(files.size());
+		for (size_t i = 0; i < index.size(); ++i)
+		{
+			index[i] = static_cast<std::uint32_t>(i);
+		}
+
+		std::ranges::sort(index, [&files](const std::uint32_t a, const std::uint32_t b)
+		{
+			return std::string_view(files[a].name) < std::string_view(files[b].name);
+		});
+
+		manifest_header header{};
+		std::memcpy(header.magic, BINARY_MANIFEST_MAGIC, sizeof(header.magic));
+		header.version = BINARY_MANIFEST_VERSION;
+		header.source_size = source_size;
+		header.record_count = static_cast<std::uint32_t>(records.size());
+		header.patch_count = static_cast<std::uint32_t>(patches.size());
+
+		size_t offset = sizeof(header);
+		header.records_offset = static_cast<std::uint32_t>(offset);
+		offset = align(offset + records.size() * sizeof(manifest_record));
+		header.patches_offset = static_cast<std::uint32_t>(offset);
+		offset = align(offset + patches.size() * sizeof(manifest_patch));
+		header.index_offset = static_cast<std::uint32_t>(offset);
+		offset = align(offset + index.size() * sizeof(std::uint32_t));
+		header.strings_offset = static_cast<std::uint32_t>(offset);
+		header.strings_size = static_cast<std::uint32_t>(strings.data.size());
+
+		if (offset + strings.data.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::runtime_error("Manifest is too large");
+		}
+
+		std::string data(offset + strings.data.size(), '\0');
+		std::memcpy(data.data(), &header, sizeof(header));
+		write_table(data, header.records_offset, records);
+		write_table(data, header.patches_offset, patches);
+		write_table(data, header.index_offset, index);
+		std::memcpy(data.data() + header.strings_offset, strings.data.data(), strings.data.size());
+
+		return data;
+	}
+
+	void binary_manifest::validate()
+	{
+		const auto data = this->data_;
+		this->data_ = {};
+
+		if (data.size() < sizeof(manifest_header))
+		{
+			return;
+		}
+
+		const auto& header = get_header(data);
+		if (std::memcmp(header.magic, BINARY_MANIFEST_MAGIC, sizeof(header.magic)) != 0 || header.version != BINARY_MANIFEST_VERSION)
+		{
+			return;
+		}
+
+		if (!is_table_valid(data, header.records_offset, header.record_count, sizeof(manifest_record))
+			|| !is_table_valid(data, header.patches_offset, header.patch_count, sizeof(manifest_patch))
+			|| !is_table_valid(data, header.index_offset, header.record_count, sizeof(std::uint32_t))
+			|| !is_table_valid(data, header.strings_offset, header.strings_size, 1))
+		{
+			return;
+		}
+
+		const auto is_string_valid = [&header](const string_ref& ref)
+		{
+			return static_cast<std::uint64_t>(ref.offset) + ref.length <= header.strings_size;
+		};
+
+		// Checked once up front, so lookups don't need any bounds checks
+		const auto* records = get_table<manifest_record>(data, header.records_offset);
+		const auto* index = get_table<std::uint32_t>(data, header.index_offset);
+
+		for (std::uint32_t i = 0; i < header.record_count; ++i)
+		{
+			const auto& record = records[i];
+			if (!is_string_valid(record.name) || !is_string_valid(record.hash) || !is_string_valid(record.tree_hash)
+				|| !is_string_valid(record.codec) || index[i] >= header.record_count
+				|| static_cast<std::uint64_t>(record.first_patch) + record.patch_count > header.patch_count)
+			{
+				return;
+			}
+		}
+
+		const auto* patches = get_table<manifest_patch>(data, header.patches_offset);
+
+		for (std::uint32_t i = 0; i < header.patch_count; ++i)
+		{
+			if (!is_string_valid(patches[i].from_hash) || !is_string_valid(patches[i].hash))
+			{
+				return;
+			}
+		}
+
+		this->data_ = data;
+	}
+
+	std::string_view binary_manifest::get_name(const std::uint32_t index) const
+	{
+		const auto& header = get_header(this->data_);
+		return get_string(this->data_, get_table<manifest_record>(this->data_, header.records_offset)[index].name);
+	}
+
+	std::span<const std::uint32_t> binary_manifest::get_index() const
+	{
+		if (this->data_.empty())
+		{
+			return {};
+		}
+
+		const auto& header = get_header(this->data_);
+		return {get_table<std::uint32_t>(this->data_, header.index_offset), header.record_count};
+	}
+
+	std::span<const std::uint32_t>::iterator binary_manifest::lower_bound(const std::string_view name) const
+	{
+		const auto index = this->get_index();
+		return std::lower_bound(index.begin(), index.end(), name, [this](const std::uint32_t record, const std::string_view value)
+		{
+			return this->get_name(record) < value;
+		});
+	}
+}
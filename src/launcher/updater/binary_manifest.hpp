@@ -0,0 +1,60 @@
+#pragma once
+
+#include "file_info.hpp"
+
+#include <utils/io.hpp>
+
+#include <span>
+
+namespace updater
+{
+	// Compact form of the manifest: a fixed-width record table, a name index sorted byte-wise and a string pool.
+	// It is queried in place, either mapped from disk or from memory, so loading it allocates nothing per entry.
+	class binary_manifest
+	{
+	public:
+		struct entry
+		{
+			std::string_view name;
+			std::uint64_t size;
+			std::string_view hash;
+			std::string_view tree_hash;
+			std::string_view codec;
+			std::uint64_t compressed_size;
+		};
+
+		binary_manifest(const std::filesystem::path& file);
+		binary_manifest(std::string data);
+
+		binary_manifest(binary_manifest&&) = delete;
+		binary_manifest(const binary_manifest&) = delete;
+		binary_manifest& operator=(binary_manifest&&) = delete;
+		binary_manifest& operator=(const binary_manifest&) = delete;
+
+		// False if the data is missing or doesn't pass validation
+		operator bool() const;
+
+		[[nodiscard]] size_t size() const;
+
+		// Size of the JSON manifest this was built from, which ties a stored copy to its source
+		[[nodiscard]] std::uint64_t get_source_size() const;
+
+		[[nodiscard]] entry get_entry(size_t index) const;
+		[[nodiscard]] file_info get_file_info(size_t index) const;
+
+		[[nodiscard]] std::optional<size_t> find(std::string_view name) const;
+		[[nodiscard]] bool has_prefix(std::string_view prefix) const;
+
+		static std::string build(const std::vector<file_info>& files, std::uint64_t source_size);
+
+	private:
+		std::unique_ptr<utils::io::mapped_file> file_{};
+		std::string buffer_{};
+		std::string_view data_{};
+
+		void validate();
+		[[nodiscard]] std::string_view get_name(std::uint32_t index) const;
+		[[nodiscard]] std::span<const std::uint32_t> get_index() const;
+		[[nodiscard]] std::span<const std::uint32_t>::iterator lower_bound(std::string_view name) const;
+	};
+}
@@ -0,0 +1,45 @@
+#include <std_include.hpp>
+
+#include "data_path_table.hpp"
+
+#include <utils/string.hpp>
+
+namespace updater
+{
+	void data_path_table::reserve(const size_t file_count)
+	{
+		// Files add their parent folders too, but most of those are shared with other files
+		this->paths_.reserve(file_count * 2);
+	}
+
+	void data_path_table::add_file(const std::string_view name)
+	{
+		if (name.empty())
+		{
+			return;
+		}
+
+		auto path = normalize(name);
+
+		// Every parent folder of a kept file is kept as well
+		for (auto separator = path.find('/'); separator != std::string::npos; separator = path.find('/', separator + 1))
+		{
+			this->paths_.emplace(path.substr(0, separator), entry_type::folder);
+		}
+
+		this->paths_.emplace(std::move(path), entry_type::file);
+	}
+
+	data_path_table::entry_type data_path_table::get_type(const std::string_view path) const
+	{
+		const auto entry = this->paths_.find(normalize(path));
+		return entry == this->paths_.end() ? entry_type::none : entry->second;
+	}
+
+	std::string data_path_table::normalize(const std::string_view path)
+	{
+		auto result = utils::string::to_lower(std::string(path));
+		std::ranges::replace(result, '\\', '/');
+		return result;
+	}
+}
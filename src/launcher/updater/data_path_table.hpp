@@ -0,0 +1,27 @@
+#pragma once
+
+namespace updater
+{
+	// Paths cleanup keeps in the data folder, along with all their parent folders.
+	// Paths are relative, case-folded and use forward slashes, so each entry on disk is classified with one lookup.
+	class data_path_table
+	{
+	public:
+		enum class entry_type
+		{
+			none,
+			file,
+			folder,
+		};
+
+		void reserve(size_t file_count);
+		void add_file(std::string_view name);
+
+		[[nodiscard]] entry_type get_type(std::string_view path) const;
+
+	private:
+		std::unordered_map<std::string, entry_type> paths_{};
+
+		static std::string normalize(std::string_view path);
+	};
+}
@@ -0,0 +1,200 @@
+#include <std_include.hpp>
+
+#include "file_index.hpp"
+
+#include <utils/flags.hpp>
+#include <utils/logger.hpp>
+
+#include <rapidjson/writer.h>
+
+#define FILE_INDEX_VERSION 1
+
+namespace updater
+{
+	namespace
+	{
+		bool is_verification_forced()
+		{
+			static const auto forced = utils::flags::has_flag("verify");
+			return forced;
+		}
+	}
+
+	file_index::file_index(std::filesystem::path file)
+		: file_(std::move(file))
+	{
+	}
+
+	void file_index::load()
+	{
+		entry_map entries{};
+
+		std::string data{};
+		if (utils::io::read_file(this->file_, &data))
+		{
+			rapidjson::Document doc{};
+			const rapidjson::ParseResult result = doc.Parse(data);
+
+			// Any malformed or outdated index is discarded as a whole, which simply causes a full verification
+			if (result && doc.IsObject() && doc.HasMember("version") && doc["version"].IsInt()
+				&& doc["version"].GetInt() == FILE_INDEX_VERSION && doc.HasMember("files") && doc["files"].IsObject())
+			{
+				for (const auto& member : doc["files"].GetObject())
+				{
+					const auto& value = member.value;
+					if (!value.IsArray() || value.Size() != 5 || !value[0].IsUint64() || !value[1].IsUint64()
+						|| !value[2].IsUint64() || !value[3].IsUint() || !value[4].IsString())
+					{
+						continue;
+					}
+
+					entry entry{};
+					entry.metadata.size = value[0].GetUint64();
+					entry.metadata.last_write_time = value[1].GetUint64();
+					entry.metadata.file_id = value[2].GetUint64();
+					entry.metadata.volume_serial = value[3].GetUint();
+					entry.hash.assign(value[4].GetString(), value[4].GetStringLength());
+
+					entries[std::string(member.name.GetString(), member.name.GetStringLength())] = std::move(entry);
+				}
+			}
+			else
+			{
+				utils::logger::write("Discarding invalid file index {}", this->file_.string());
+			}
+		}
+
+		this->entries_.access([&entries](entry_map& map)
+		{
+			map = std::move(entries);
+		});
+	}
+
+	void file_index::save() const
+	{
+		rapidjson::Document doc{};
+		doc.SetObject();
+
+		auto& allocator = doc.GetAllocator();
+
+		rapidjson::Value files{};
+		files.SetObject();
+
+		this->entries_.access([&](const entry_map& map)
+		{
+			for (const auto& [name, entry] : map)
+			{
+				rapidjson::Value value{};
+				value.SetArray();
+				value.PushBack(entry.metadata.size, allocator);
+				value.PushBack(entry.metadata.last_write_time, allocator);
+				value.PushBack(entry.metadata.file_id, allocator);
+				value.PushBack(entry.metadata.volume_serial, allocator);
+				value.PushBack(rapidjson::Value(entry.hash, allocator), allocator);
+
+				files.AddMember(rapidjson::Value(name, allocator), value, allocator);
+			}
+		});
+
+		doc.AddMember("version", FILE_INDEX_VERSION, allocator);
+		doc.AddMember("files", files, allocator);
+
+		rapidjson::StringBuffer buffer{};
+		rapidjson::Writer<rapidjson::StringBuffer, rapidjson::Document::EncodingType, rapidjson::ASCII<>> writer(buffer);
+		doc.Accept(writer);
+
+		// Write to a temporary file first, a torn index must never be mistaken for a valid one
+		auto temp_file = this->file_;
+		temp_file += ".tmp";
+
+		if (!utils::io::write_file(temp_file, std::string(buffer.GetString(), buffer.GetSize()))
+			|| !utils::io::move_file(temp_file, this->file_, true))
+		{
+			utils::logger::write("Failed to write file index {}", this->file_.string());
+			utils::io::remove_file(temp_file);
+		}
+	}
+
+	bool file_index::is_verified(const file_info& file, const utils::io::file_metadata& metadata) const
+	{
+		if (is_verification_forced())
+		{
+			return false;
+		}
+
+		return this->entries_.access<bool>([&](const entry_map& map)
+		{
+			const auto entry = map.find(file.name);
+			return entry != map.end()
+				&& entry->second.metadata == metadata
+				&& entry->second.hash == file.hash;
+		});
+	}
+
+	void file_index::mark_verified(const file_info& file, const utils::io::file_metadata& metadata)
+	{
+		this->entries_.access([&](entry_map& map)
+		{
+			auto& entry = map[file.name];
+			entry.metadata = metadata;
+			entry.hash = file.hash;
+		});
+	}
+
+	void file_index::invalidate(const file_info& file)
+	{
+		this->entries_.access([&](entry_map& map)
+		{
+			map.erase(file.name);
+		});
+	}
+
+	void file_index::retain(const std::vector<file_info>& files)
+	{
+		std::unordered_set<std::string> names{};
+		for (const auto& file : files)
+		{
+			names.emplace(file.name);
+		}
+
+		this->entries_.access([&names](entry_map& map)
+		{
+			std::erase_if(map, [&names](const auto& entry)
+			{
+				return !names.contains(entry.first);
+			});
+		});
+	}
+
+	bool file_index::is_intact(const std::function<std::filesystem::path(const std::string&)>& get_path) const
+	{
+		if (is_verification_forced())
+		{
+			return false;
+		}
+
+		const auto entries = this->entries_.access<entry_map>([](const entry_map& map)
+		{
+			return map;
+		});
+
+		if (entries.empty())
+		{
+			return false;
+		}
+
+		return std::ranges::all_of(entries, [&get_path](const auto& entry)
+		{
+			const auto metadata = utils::io::get_file_metadata(get_path(entry.first));
+			return metadata && *metadata == entry.second.metadata;
+		});
+	}
+
+	size_t file_index::get_size() const
+	{
+		return this->entries_.access<size_t>([](const entry_map& map)
+		{
+			return map.size();
+		});
+	}
+}
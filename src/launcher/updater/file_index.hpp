@@ -0,0 +1,41 @@
+#pragma once
+
+#include "file_info.hpp"
+
+#include <utils/io.hpp>
+#include <utils/concurrency.hpp>
+
+namespace updater
+{
+	// Remembers the metadata of files whose hash has already been verified,
+	// so unchanged files don't have to be read and hashed again on every launch
+	class file_index
+	{
+	public:
+		file_index(std::filesystem::path file);
+
+		void load();
+		void save() const;
+
+		[[nodiscard]] bool is_verified(const file_info& file, const utils::io::file_metadata& metadata) const;
+		void mark_verified(const file_info& file, const utils::io::file_metadata& metadata);
+		void invalidate(const file_info& file);
+		void retain(const std::vector<file_info>& files);
+
+		// Checks all indexed files against their metadata on disk, which needs no manifest
+		[[nodiscard]] bool is_intact(const std::function<std::filesystem::path(const std::string&)>& get_path) const;
+		[[nodiscard]] size_t get_size() const;
+
+	private:
+		struct entry
+		{
+			utils::io::file_metadata metadata{};
+			std::string hash{};
+		};
+
+		using entry_map = std::unordered_map<std::string, entry>;
+
+		std::filesystem::path file_;
+		utils::concurrency::container<entry_map> entries_{};
+	};
+}
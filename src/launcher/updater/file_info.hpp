@@ -1,13 +1,31 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace updater
 {
+	struct patch_info
+	{
+		std::string from_hash;
+		std::size_t size;
+		std::string hash;
+	};
+
 	struct file_info
 	{
 		std::string name;
 		std::size_t size;
 		std::string hash;
+
+		// Optional BLAKE3 digest, which allows verifying large files on several cores
+		std::string tree_hash{};
+
+		// Optional patches that turn a known older version into this one
+		std::vector<patch_info> patches{};
+
+		// Optional precompressed variant next to the file, e.g. "gzip" for <name>.gz
+		std::string codec{};
+		std::size_t compressed_size{};
 	};
 }
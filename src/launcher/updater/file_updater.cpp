@@ -3,12 +3,18 @@
 #include "updater.hpp"
 #include "updater_ui.hpp"
 #include "file_updater.hpp"
+#include "manifest_parser.hpp"
+#include "data_path_table.hpp"
 
 #include <utils/cryptography.hpp>
 #include <utils/http.hpp>
 #include <utils/io.hpp>
 #include <utils/logger.hpp>
 #include <utils/compression.hpp>
+#include <utils/thread_pool.hpp>
+#include <utils/string.hpp>
+#include <utils/delta.hpp>
+#include <utils/chunking.hpp>
 
 #include <rapidjson/writer.h>
 
@@ -22,6 +28,21 @@
 
 #define UPDATE_HOST_BINARY "xlabs.exe"
 
+// Smaller files are faster to verify with a single SHA-1 stream
+#define TREE_HASH_MIN_SIZE (64 * 1024 * 1024)
+
+// Smaller files are not worth the extra request for their chunk index
+#define CHUNKED_UPDATE_MIN_SIZE (1024 * 1024)
+#define CHUNKED_UPDATE_MAX_RANGE (8 * 1024 * 1024)
+
+// Larger files are fetched as byte ranges over several connections
+#define SEGMENTED_DOWNLOAD_MIN_SIZE (32 * 1024 * 1024)
+#define SEGMENTED_DOWNLOAD_MAX_CONNECTIONS 8
+#define SEGMENT_MIN_SIZE (4 * 1024 * 1024)
+#define SEGMENT_MAX_SIZE (64 * 1024 * 1024)
+#define SEGMENT_DEFAULT_SIZE (8 * 1024 * 1024)
+#define SEGMENT_TARGET_SECONDS 4
+
 #define IW4X_VERSION_FILE ".version.json"
 #define IW4X_RAWFILES_UPDATE_FILE "release.zip"
 #define IW4X_RAWFILES_UPDATE_URL "https://github.com/XLabsProject/iw4x-rawfiles/releases/latest/download/" IW4X_RAWFILES_UPDATE_FILE
@@ -41,163 +62,1073 @@ namespace updater
 			return is_main_channel() ? UPDATE_FOLDER_MAIN : UPDATE_FOLDER_DEV;
 		}
 
-		std::vector<file_info> parse_file_infos(const std::string& json)
+		// Checks manifest entries against the disk on the thread pool as soon as the parser hands them out
+		class outdated_scan
+		{
+		public:
+			outdated_scan(std::function<bool(const file_info&)> is_outdated, std::function<void(const file_info&)> on_outdated = {})
+				: is_outdated_(std::move(is_outdated))
+				, on_outdated_(std::move(on_outdated))
+			{
+			}
+
+			~outdated_scan()
+			{
+				this->wait();
+			}
+
+			outdated_scan(outdated_scan&&) = delete;
+			outdated_scan(const outdated_scan&) = delete;
+			outdated_scan& operator=(outdated_scan&&) = delete;
+			outdated_scan& operator=(const outdated_scan&) = delete;
+
+			void add(file_info&& file)
+			{
+				std::lock_guard _{this->mutex_};
+
+				// Deque elements keep their address while new ones are appended, so tasks can hold on to them
+				auto& entry = this->files_.emplace_back(std::move(file));
+				auto& flag = this->outdated_flags_.emplace_back(0);
+				++this->pending_;
+
+				utils::thread_pool::get().post([this, &entry, &flag]()
+				{
+					std::exception_ptr error{};
+
+					try
+					{
+						flag = this->is_outdated_(entry);
+
+						if (flag && this->on_outdated_)
+						{
+							this->on_outdated_(entry);
+						}
+					}
+					catch (...)
+					{
+						error = std::current_exception();
+					}
+
+					std::lock_guard _{this->mutex_};
+
+					if (error && !this->error_)
+					{
+						this->error_ = error;
+					}
+
+					if (--this->pending_ == 0)
+					{
+						this->finished_.notify_all();
+					}
+				});
+			}
+
+			// Returns whether all checks are done, so the caller can take care of other work in between
+			bool wait_for(const std::chrono::milliseconds timeout)
+			{
+				std::unique_lock lock{this->mutex_};
+				return this->finished_.wait_for(lock, timeout, [this]()
+				{
+					return this->pending_ == 0;
+				});
+			}
+
+			// Waits for all checks and returns every file as well as the outdated ones, both in manifest order
+			std::pair<std::vector<file_info>, std::vector<file_info>> finish()
+			{
+				this->wait();
+
+				if (this->error_)
+				{
+					std::rethrow_exception(this->error_);
+				}
+
+				std::vector<file_info> outdated_files{};
+
+				for (size_t i = 0; i < this->files_.size(); ++i)
+				{
+					if (this->outdated_flags_[i])
+					{
+						outdated_files.emplace_back(this->files_[i]);
+					}
+				}
+
+				std::vector<file_info> files{std::make_move_iterator(this->files_.begin()), std::make_move_iterator(this->files_.end())};
+				this->files_.clear();
+				this->outdated_flags_.clear();
+
+				return {std::move(files), std::move(outdated_files)};
+			}
+
+		private:
+			std::function<bool(const file_info&)> is_outdated_;
+			std::function<void(const file_info&)> on_outdated_;
+
+			std::mutex mutex_{};
+			std::condition_variable finished_{};
+			std::deque<file_info> files_{};
+			std::deque<char> outdated_flags_{};
+			size_t pending_{};
+			std::exception_ptr error_{};
+
+			void wait()
+			{
+				std::unique_lock lock{this->mutex_};
+				this->finished_.wait(lock, [this]()
+				{
+					return this->pending_ == 0;
+				});
+			}
+		};
+
+		// Outdated files found by the scan workers, they are started by the thread running the update.
+		// Only that thread may create the progress dialog, COM isn't initialized on the pool threads.
+		// Nothing is handed out before the host binary is known to be current, an outdated launcher is replaced first
+		// and the data is then updated by the new one.
+		class outdated_queue
+		{
+		public:
+			void add(const file_info& file)
+			{
+				this->state_.access([&file](state& data)
+				{
+					data.files.emplace_back(file);
+				});
+			}
+
+			void set_host_outdated(const bool outdated)
+			{
+				this->state_.access([outdated](state& data)
+				{
+					data.host = outdated ? host_state::outdated : host_state::current;
+				});
+			}
+
+			// Called once the scan is complete, a manifest without host binary holds nothing back
+			void finish()
+			{
+				this->state_.access([](state& data)
+				{
+					if (data.host == host_state::unknown)
+					{
+						data.host = host_state::current;
+					}
+				});
+			}
+
+			[[nodiscard]] bool is_host_outdated() const
+			{
+				return this->state_.access<bool>([](const state& data)
+				{
+					return data.host == host_state::outdated;
+				});
+			}
+
+			std::vector<file_info> take()
+			{
+				return this->state_.access<std::vector<file_info>>([](state& data)
+				{
+					if (data.host != host_state::current)
+					{
+						return std::vector<file_info>{};
+					}
+
+					return std::exchange(data.files, {});
+				});
+			}
+
+		private:
+			enum class host_state
+			{
+				unknown,
+				current,
+				outdated,
+			};
+
+			struct state
+			{
+				std::vector<file_info> files{};
+				host_state host{host_state::unknown};
+			};
+
+			utils::concurrency::container<state> state_{};
+		};
+
+		std::optional<std::string> get_file_hash(const std::filesystem::path& file)
+		{
+			utils::io::mapped_file mapped_file{file};
+			if (!mapped_file)
+			{
+				return {};
+			}
+
+			utils::cryptography::sha1::context context{};
+			const auto result = mapped_file.for_each_window([&context](const std::string_view data)
+			{
+				context.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+			});
+
+			if (!result)
+			{
+				return {};
+			}
+
+			return {context.finalize(true)};
+		}
+
+		std::optional<std::string> get_file_tree_hash(const std::filesystem::path& file)
+		{
+			utils::io::mapped_file mapped_file{file};
+			if (!mapped_file)
+			{
+				return {};
+			}
+
+			// The whole file is mapped at once, so its subtrees can be hashed by all threads
+			const auto size = static_cast<size_t>(mapped_file.get_size());
+			const auto data = mapped_file.map(0, size);
+			if (data.size() != size)
+			{
+				return {};
+			}
+
+			return {utils::cryptography::blake3::compute_parallel(reinterpret_cast<const uint8_t*>(data.data()), data.size(), true)};
+		}
+
+		bool is_file_hash_valid(const file_info& file, const std::filesystem::path& drive_name)
+		{
+			if (!file.tree_hash.empty() && file.size >= TREE_HASH_MIN_SIZE)
+			{
+				const auto hash = get_file_tree_hash(drive_name);
+				return hash && *hash == file.tree_hash;
+			}
+
+			const auto hash = get_file_hash(drive_name);
+			return hash && *hash == file.hash;
+		}
+
+		// Streams the data to disk and hashes it while it is being downloaded,
+		// so the digest is ready once the last byte arrives
+		class hashing_sink : public utils::http::file_sink
+		{
+		public:
+			hashing_sink(std::filesystem::path target, std::string resume_key = {})
+				: file_sink(std::move(target), std::move(resume_key))
+			{
+				// A prefix resumed from an earlier launch is part of the digest as well
+				if (this->get_size() > 0)
+				{
+					this->read_contents([this](const std::string_view data)
+					{
+						this->hash_.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+					});
+				}
+			}
+
+			void reset() override
+			{
+				file_sink::reset();
+				this->hash_.reset();
+			}
+
+			void write(const char* data, const size_t length) override
+			{
+				file_sink::write(data, length);
+				this->hash_.update(reinterpret_cast<const uint8_t*>(data), length);
+				this->last_write_ = std::chrono::steady_clock::now();
+			}
+
+			[[nodiscard]] std::string get_hash()
+			{
+				return this->hash_.finalize(true);
+			}
+
+			[[nodiscard]] std::chrono::steady_clock::time_point get_last_write() const
+			{
+				return this->last_write_;
+			}
+
+		private:
+			utils::cryptography::sha1::context hash_{};
+			std::chrono::steady_clock::time_point last_write_{std::chrono::steady_clock::now()};
+		};
+
+		bool has_partial_download(const std::filesystem::path& out_file)
+		{
+			auto state_file = out_file;
+			state_file += ".part.state";
+			return utils::io::file_exists(state_file.wstring());
+		}
+
+		std::string get_patch_url(const file_info& file, const patch_info& patch)
+		{
+			return get_update_folder() + "patches/" + patch.from_hash + "-" + file.hash;
+		}
+
+		std::string get_chunk_index_url(const file_info& file)
+		{
+			return get_update_folder() + "chunks/" + file.hash + ".json";
+		}
+
+		struct chunk_info
+		{
+			std::uint64_t offset{};
+			size_t size{};
+			std::string hash{};
+		};
+
+		struct chunk_index
+		{
+			utils::chunking::parameters parameters{};
+			std::vector<chunk_info> chunks{};
+		};
+
+		// {"min": 16384, "avg": 65536, "max": 262144, "chunks": [[size, "sha1"], ...]}
+		std::optional<chunk_index> parse_chunk_index(const std::string& json, const file_info& file)
 		{
 			rapidjson::Document doc{};
-			doc.Parse(json.data(), json.size());
+			const rapidjson::ParseResult result = doc.Parse(json);
+			if (!result || !doc.IsObject())
+			{
+				return {};
+			}
+
+			const auto get_size = [&doc](const char* name) -> std::optional<size_t>
+			{
+				if (!doc.HasMember(name) || !doc[name].IsUint())
+				{
+					return {};
+				}
+
+				return {doc[name].GetUint()};
+			};
+
+			const auto min_size = get_size("min");
+			const auto average_size = get_size("avg");
+			const auto max_size = get_size("max");
+
+			if (!min_size || !average_size || !max_size || !doc.HasMember("chunks") || !doc["chunks"].IsArray())
+			{
+				return {};
+			}
+
+			// The index comes from the server, limits that can't split anything would stall the chunking
+			if (*min_size == 0 || *average_size < *min_size || *max_size < *average_size)
+			{
+				return {};
+			}
+
+			chunk_index index{};
+			index.parameters.min_size = *min_size;
+			index.parameters.average_size = *average_size;
+			index.parameters.max_size = *max_size;
+
+			std::uint64_t offset = 0;
+			for (const auto& element : doc["chunks"].GetArray())
+			{
+				if (!element.IsArray() || element.Size() < 2 || !element[0].IsUint() || !element[1].IsString() || element[0].GetUint() == 0)
+				{
+					return {};
+				}
+
+				chunk_info chunk{};
+				chunk.offset = offset;
+				chunk.size = element[0].GetUint();
+				chunk.hash = utils::string::to_upper({element[1].GetString(), element[1].GetStringLength()});
+
+				offset += chunk.size;
+				index.chunks.emplace_back(std::move(chunk));
+			}
 
-			if (!doc.IsArray())
+			if (offset != file.size)
 			{
 				return {};
 			}
 
-			std::vector<file_info> files{};
+			return {std::move(index)};
+		}
+
+		// Collects a requested byte range and aborts the transfer if the server ignores the range
+		class range_sink : public utils::http::data_sink
+		{
+		public:
+			range_sink(const size_t length)
+				: length_(length)
+			{
+				this->data_.reserve(length);
+			}
+
+			void reset() override
+			{
+				this->data_.clear();
+			}
+
+			void write(const char* data, const size_t length) override
+			{
+				if (length > this->length_ - this->data_.size())
+				{
+					throw std::runtime_error("Server returned more data than requested");
+				}
+
+				this->data_.append(data, length);
+			}
+
+			[[nodiscard]] const std::string& get_data() const
+			{
+				return this->data_;
+			}
+
+		private:
+			size_t length_{};
+			std::string data_{};
+		};
+
+		// Writes a byte range straight to its position in a preallocated file
+		class segment_sink : public utils::http::data_sink
+		{
+		public:
+			segment_sink(utils::io::atomic_file& file, const std::uint64_t offset, const std::uint64_t length,
+			             std::atomic<std::uint64_t>& downloaded)
+				: file_(file)
+				, offset_(offset)
+				, length_(length)
+				, downloaded_(downloaded)
+			{
+			}
 
-			for (const auto& element : doc.GetArray())
+			void reset() override
 			{
-				if (!element.IsArray())
+				this->downloaded_ -= this->written_;
+				this->written_ = 0;
+			}
+
+			void write(const char* data, const size_t length) override
+			{
+				if (length > this->length_ - this->written_)
+				{
+					throw std::runtime_error("Server returned more data than requested");
+				}
+
+				this->file_.write_at(this->offset_ + this->written_, data, length);
+				this->written_ += length;
+				this->downloaded_ += length;
+			}
+
+			[[nodiscard]] std::uint64_t get_written() const
+			{
+				return this->written_;
+			}
+
+		private:
+			utils::io::atomic_file& file_;
+			std::uint64_t offset_{};
+			std::uint64_t length_{};
+			std::uint64_t written_{};
+			std::atomic<std::uint64_t>& downloaded_;
+		};
+
+		const file_info* find_host_file_info(const std::vector<file_info>& outdated_files)
+		{
+			for (const auto& file : outdated_files)
+			{
+				if (file.name == UPDATE_HOST_BINARY)
+				{
+					return &file;
+				}
+			}
+
+			return nullptr;
+		}
+
+		// Everything but the host binary lives in the data folder, is staged and backed by the object store.
+		// The host binary directly replaces the process file that was moved aside, staging it would only delay that.
+		bool is_data_file(const file_info& file)
+		{
+			return file.name != UPDATE_HOST_BINARY;
+		}
+
+		size_t get_optimal_concurrent_download_count(const size_t file_count)
+		{
+			// Workers only hash and write what the transfer engine receives, so their count follows the transfer limit
+			return std::max(1ull, std::min(utils::http::get_max_concurrent_transfers(), file_count));
+		}
+
+		// Everything cleanup keeps in the data folder, built in a single pass over the manifest
+		data_path_table get_data_path_table(const binary_manifest& manifest)
+		{
+			data_path_table table{};
+			table.reserve(manifest.size() * 2);
+
+			for (size_t i = 0; i < manifest.size(); ++i)
+			{
+				const auto entry = manifest.get_entry(i);
+				if (entry.name == UPDATE_HOST_BINARY)
 				{
 					continue;
 				}
 
-				auto array = element.GetArray();
+				table.add_file(entry.name);
+
+				// Stored objects nobody references anymore are collected like any other unknown file
+				table.add_file(object_store::get_object_name(entry.hash));
+			}
+
+			return table;
+		}
+	}
+
+	file_updater::file_updater(progress_listener& listener, std::filesystem::path base, std::filesystem::path process_file)
+		: listener_(listener)
+		, base_(std::move(base))
+		, process_file_(std::move(process_file))
+		, dead_process_file_(process_file_)
+		, file_index_(base_ / "user" / "file-index.json")
+		, manifest_cache_(base_ / "user")
+		, journal_(base_ / "user")
+		, object_store_(base_ / "data", is_file_hash_valid)
+	{
+		this->dead_process_file_.replace_extension(".exe.old");
+		this->delete_old_process_file();
+	}
+
+	void file_updater::run() const
+	{
+		utils::logger::write("Using {} SHA-1 implementation", utils::cryptography::sha1::get_implementation());
+		utils::logger::write("Using {} with up to {} concurrent transfers", utils::http::supports_http2() ? "HTTP/2" : "HTTP/1.1",
+		                     utils::http::get_max_concurrent_transfers());
+
+		this->file_index_.load();
+		const auto _ = gsl::finally([this]()
+		{
+			this->file_index_.save();
+		});
+
+		// An update that was interrupted while moving its files into place is finished before anything else
+		this->recover_staged_files();
+
+		this->manifest_cache_.load();
+
+		const auto start = std::chrono::steady_clock::now();
+
+		// Outdated files are downloaded as soon as the scan finds them, the progress only shows up once there is one
+		update_pipeline pipeline{utils::http::get_max_concurrent_transfers(), this->get_update_stages(false)};
+		outdated_queue found_files{};
+		auto has_started = false;
+
+		const auto start_found_files = [&]()
+		{
+			for (const auto& file : found_files.take())
+			{
+				if (!has_started)
+				{
+					this->listener_.update_files({});
+					has_started = true;
+				}
+
+				this->listener_.add_file(file);
+				pipeline.push(file);
+			}
+		};
 
-				file_info info{};
-				info.name.assign(array[0].GetString(), array[0].GetStringLength());
-				info.size = array[1].GetInt64();
-				info.hash.assign(array[2].GetString(), array[2].GetStringLength());
+		outdated_scan scan{[this, &found_files](const file_info& file)
+		{
+			const auto outdated = this->is_outdated_file(file);
+			if (file.name == UPDATE_HOST_BINARY)
+			{
+				found_files.set_host_outdated(outdated);
+			}
 
-				files.emplace_back(std::move(info));
+			return outdated;
+		}, [&](const file_info& file)
+		{
+			// The host binary isn't part of the pipeline, it is replaced on its own before any data file
+			if (file.name == UPDATE_HOST_BINARY)
+			{
+				return;
 			}
 
-			return files;
+			found_files.add(file);
+		}};
+
+		manifest_parser parser{[&scan](file_info&& file)
+		{
+			scan.add(std::move(file));
+		}};
+
+		// Entries are parsed and checked against the disk while the rest of the manifest is still arriving
+		const auto manifest = this->manifest_cache_.fetch(get_update_file(), [&](const std::string_view data)
+		{
+			parser.write(data);
+			start_found_files();
+		});
+
+		const auto get_path = [this](const std::string& name)
+		{
+			return this->get_drive_filename(file_info{name});
+		};
+
+		// Nothing changed on either side since the last complete verification, the manifest doesn't even need parsing
+		if (manifest && this->manifest_cache_.is_verified(this->file_index_.get_size()) && this->file_index_.is_intact(get_path))
+		{
+			utils::logger::write("Manifest and files are unchanged since the last verification");
+			return;
 		}
 
-		std::vector<file_info> get_file_infos()
+		// An unchanged manifest usually has a compact copy from an earlier launch, which needs no parsing at all
+		std::optional<binary_manifest> binary{};
+		if (manifest && this->manifest_cache_.is_unchanged())
 		{
-			const auto json = utils::http::get_data(get_update_file());
-			if (!json)
+			const auto load_start = std::chrono::steady_clock::now();
+			binary.emplace(this->manifest_cache_.get_binary_file());
+
+			if (*binary && binary->get_source_size() == manifest->size())
 			{
-				return {};
+				const auto load_duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - load_start);
+				utils::logger::write("Loaded binary manifest with {} entries in {}us", binary->size(), load_duration.count());
+
+				for (size_t i = 0; i < binary->size(); ++i)
+				{
+					scan.add(binary->get_file_info(i));
+				}
+			}
+			else
+			{
+				binary.reset();
+			}
+		}
+
+		// Otherwise an unchanged manifest comes from the cache and didn't pass through the parser yet
+		if (manifest && !binary && parser.get_written_size() == 0)
+		{
+			parser.write(*manifest);
+		}
+
+		const auto parsed = binary.has_value() || parser.finish();
+
+		// The remaining checks still overlap with the downloads of the files they already found
+		if (manifest && parsed)
+		{
+			while (!scan.wait_for(std::chrono::milliseconds(100)))
+			{
+				start_found_files();
+			}
+		}
+
+		auto [files, outdated_files] = scan.finish();
+		found_files.finish();
+
+		// Files of a broken manifest that are already in progress are still finished, nothing else is started
+		if (!manifest || !parsed)
+		{
+			files.clear();
+			outdated_files.clear();
+			pipeline.cancel();
+		}
+		else if (found_files.is_host_outdated())
+		{
+			// No data file was started, the new launcher takes care of them after the relaunch
+			pipeline.cancel();
+		}
+		else
+		{
+			start_found_files();
+			pipeline.close();
+		}
+
+		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		utils::logger::write("Fetched manifest and scanned {} files for updates in {}ms, {} outdated", files.size(),
+			duration.count(), outdated_files.size());
+
+		if (!files.empty() && !binary)
+		{
+			auto data = binary_manifest::build(files, manifest->size());
+			this->manifest_cache_.store_binary(data);
+			binary.emplace(std::move(data));
+		}
+
+		// Cleanup keeps every file of the manifest and its partial download, so it can run while the downloads do
+		if (!files.empty())
+		{
+			this->cleanup_directories(*binary);
+			this->file_index_.retain(files);
+			this->journal_.retain(files);
+		}
+
+		pipeline.finish();
+
+		// Relaunches if the host binary was replaced, so the data is never updated with outdated logic
+		this->update_host_binary(outdated_files);
+
+		// A broken manifest would leave a mix of old and new files, its staged files stay recorded for the next run
+		if (manifest && parsed)
+		{
+			this->commit_staged_files();
+		}
+
+		if (has_started)
+		{
+			this->listener_.done_update();
+		}
+
+		if (!files.empty())
+		{
+			this->manifest_cache_.mark_verified(this->file_index_.get_size());
+		}
+	}
+
+	void file_updater::update_file(const file_info& file, bool iw4x_file) const
+	{
+		auto url = get_update_folder() + file.name;
+		utils::logger::write("Updating file {}", url);
+
+		if (iw4x_file)
+		{
+			url = file.name;
+			utils::logger::write("This is an iw4x file, the url has been changed to {} instead", url);
+		}
+
+		auto out_file = this->get_drive_filename(file);
+
+		// IW4x hack to fetch release from github
+		if (iw4x_file)
+		{
+			out_file = this->base_ / std::filesystem::path(file.name).filename().string();
+		}
+		else if (is_data_file(file))
+		{
+			// Files are staged first and only moved into place once the whole update is complete, see update_journal
+			out_file = this->journal_.get_staging_file(file.name);
+
+			if (this->journal_.is_staged(file) && is_file_hash_valid(file, out_file))
+			{
+				utils::logger::write("Reusing file {} staged by an interrupted update", file.name);
+				return;
+			}
+
+			// Content that is stored already, e.g. under another name, never has to be fetched again
+			if (this->object_store_.extract(file, out_file))
+			{
+				utils::logger::write("Restored file {} from the object store", file.name);
+				return;
+			}
+		}
+
+		utils::logger::write("Writing file to {} ", out_file.string());
+
+		// A partial download left by an earlier launch is cheaper to finish than patching or rebuilding the file
+		const auto resume_key = iw4x_file ? std::string{} : file.hash;
+		const auto has_partial = !resume_key.empty() && has_partial_download(out_file);
+
+		if (iw4x_file || has_partial || (!this->try_patch_file(file, out_file) && !this->try_rebuild_file(file, out_file)
+			&& !this->try_download_segmented(file, url, out_file)))
+		{
+			hashing_sink sink{out_file, resume_key};
+			if (sink.get_resumed_size() > 0)
+			{
+				utils::logger::write("Resuming download of {} at {} of {} bytes", file.name, sink.get_resumed_size(),
+				                     file.size);
+			}
+
+			auto result = false;
+
+			// The precompressed variant is decoded while it arrives, the hash check below still covers the plain data
+			if (!iw4x_file && file.codec == "gzip" && file.compressed_size > 0 && sink.get_size() == 0)
+			{
+				try
+				{
+					// Servers that label .gz files with a gzip content encoding must not get them decoded twice
+					utils::http::gzip_sink decoded{sink};
+					result = utils::http::get_data(url + ".gz", decoded, {{"Accept-Encoding", "identity"}}, [&](const size_t progress)
+					{
+						this->listener_.file_progress(file, (progress * file.size) / file.compressed_size);
+					});
+
+					if (result)
+					{
+						decoded.finish();
+					}
+				}
+				catch (const update_cancelled&)
+				{
+					throw;
+				}
+				catch (const std::exception& e)
+				{
+					utils::logger::write("Failed to download compressed file {}, falling back to the plain file: {}", file.name, e.what());
+					sink.reset();
+					result = false;
+				}
+			}
+
+			// Whatever was decoded so far is continued with a range request on the plain file
+			if (!result)
+			{
+				result = utils::http::get_data(url, sink, {}, [&](const size_t progress)
+				{
+					this->listener_.file_progress(file, progress);
+				});
+			}
+
+			// IW4x files have invalid hash and size for now
+			if (!result || (!iw4x_file && (sink.get_size() != file.size || sink.get_hash() != file.hash)))
+			{
+				// A corrupted partial file must not be resumed again
+				if (result)
+				{
+					sink.reset();
+				}
+
+				throw std::runtime_error("Failed to download: " + url);
+			}
+
+			sink.commit();
+
+			const auto commit_time = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - sink.get_last_write());
+			utils::logger::write("Committed file {} {}us after the last byte", file.name, commit_time.count());
+		}
+
+		utils::logger::write("Done updating file {}", file.name);
+	}
+
+	bool file_updater::try_patch_file(const file_info& file, const std::filesystem::path& out_file) const
+	{
+		if (file.patches.empty())
+		{
+			return false;
+		}
+
+		const auto source_file = this->get_update_source(file);
+		const auto source_hash = get_file_hash(source_file);
+		if (!source_hash)
+		{
+			return false;
+		}
+
+		const auto patch = std::find_if(file.patches.begin(), file.patches.end(), [&](const patch_info& candidate)
+		{
+			return candidate.from_hash == *source_hash;
+		});
+
+		if (patch == file.patches.end())
+		{
+			return false;
+		}
+
+		const auto url = get_patch_url(file, *patch);
+		utils::logger::write("Patching file {} using {}", file.name, url);
+
+		try
+		{
+			// Patches are small, progress is scaled so it still adds up to the file size
+			const auto patch_data = utils::http::get_data(url, {}, [&](const size_t progress)
+			{
+				this->listener_.file_progress(file, patch->size ? (progress * file.size) / patch->size : 0);
+			});
+
+			if (!patch_data || patch_data->size() != patch->size || utils::cryptography::sha1::compute(*patch_data, true) != patch->hash)
+			{
+				throw std::runtime_error("Failed to download patch: " + url);
+			}
+
+			hashing_sink sink{out_file};
+
+			{
+				utils::io::mapped_file source{source_file};
+				const auto source_size = static_cast<size_t>(source.get_size());
+				const auto source_data = source.map(0, source_size);
+				if (!source || source_data.size() != source_size)
+				{
+					throw std::runtime_error("Failed to map: " + source_file.string());
+				}
+
+				utils::delta::apply(source_data, *patch_data, [&sink](const std::string_view data)
+				{
+					sink.write(data.data(), data.size());
+				});
+			}
+
+			if (sink.get_size() != file.size || sink.get_hash() != file.hash)
+			{
+				throw std::runtime_error("Patched file does not match: " + file.name);
 			}
 
-			return parse_file_infos(*json);
+			sink.commit();
+			utils::logger::write("Patched file {} with {} bytes instead of {}", file.name, patch->size, file.size);
+
+			return true;
 		}
+		catch (const update_cancelled&)
+		{
+			throw;
+		}
+		catch (const std::exception& e)
+		{
+			utils::logger::write("Failed to patch file {}, falling back to a full download: {}", file.name, e.what());
+			return false;
+		}
+	}
+
+	bool file_updater::try_rebuild_file(const file_info& file, const std::filesystem::path& out_file) const
+	{
+		if (file.size < CHUNKED_UPDATE_MIN_SIZE)
+		{
+			return false;
+		}
+
+		const auto source_file = this->get_update_source(file);
+		if (!utils::io::get_file_metadata(source_file))
+		{
+			return false;
+		}
+
+		try
+		{
+			const auto index_data = utils::http::get_data(get_chunk_index_url(file));
+			if (!index_data)
+			{
+				return false;
+			}
+
+			const auto index = parse_chunk_index(*index_data, file);
+			if (!index)
+			{
+				throw std::runtime_error("Invalid chunk index");
+			}
+
+			const auto& chunks = index->chunks;
+			const auto url = get_update_folder() + file.name;
+
+			hashing_sink sink{out_file};
+
+			{
+				utils::io::mapped_file source{source_file};
+				const auto source_size = static_cast<size_t>(source.get_size());
+				const auto source_data = source.map(0, source_size);
+				if (!source || source_data.size() != source_size)
+				{
+					throw std::runtime_error("Failed to map: " + source_file.string());
+				}
+
+				// Chunk boundaries only depend on the content, so any older version shares most of them
+				std::vector<std::string_view> source_chunks{};
+				utils::chunking::split(source_data, index->parameters, [&source_chunks](const std::string_view chunk)
+				{
+					source_chunks.push_back(chunk);
+				});
+
+				// The chunks are independent, so several of them are hashed at once
+				const auto source_hashes = utils::cryptography::sha1::compute_many(source_chunks, true);
+
+				std::unordered_map<std::string, std::string_view> local_chunks{};
+				for (size_t i = 0; i < source_chunks.size(); ++i)
+				{
+					local_chunks.try_emplace(source_hashes[i], source_chunks[i]);
+				}
+
+				const auto find_local_chunk = [&local_chunks](const chunk_info& chunk) -> std::optional<std::string_view>
+				{
+					const auto entry = local_chunks.find(chunk.hash);
+					if (entry == local_chunks.end() || entry->second.size() != chunk.size)
+					{
+						return {};
+					}
 
-		std::string get_hash(const std::string& data)
-		{
-			return utils::cryptography::sha1::compute(data, true);
-		}
+					return {entry->second};
+				};
 
-		const file_info* find_host_file_info(const std::vector<file_info>& outdated_files)
-		{
-			for (const auto& file : outdated_files)
-			{
-				if (file.name == UPDATE_HOST_BINARY)
+				size_t reusable_size = 0;
+				for (const auto& chunk : chunks)
 				{
-					return &file;
+					if (find_local_chunk(chunk))
+					{
+						reusable_size += chunk.size;
+					}
 				}
-			}
 
-			return nullptr;
-		}
+				if (reusable_size == 0)
+				{
+					return false;
+				}
 
-		size_t get_optimal_concurrent_download_count(const size_t file_count)
-		{
-			size_t cores = std::thread::hardware_concurrency();
-			cores = (cores * 2) / 3;
-			return std::max(1ull, std::min(cores, file_count));
-		}
+				utils::logger::write("Rebuilding file {} from {} local bytes, fetching {} bytes", file.name, reusable_size, file.size - reusable_size);
 
-		bool is_inside_folder(const std::filesystem::path& file, const std::filesystem::path& folder)
-		{
-			const auto relative = std::filesystem::relative(file, folder);
-			const auto start = relative.begin();
-			return start != relative.end() && start->string() != "..";
-		}
-	}
+				for (size_t i = 0; i < chunks.size();)
+				{
+					if (const auto local_chunk = find_local_chunk(chunks[i]))
+					{
+						sink.write(local_chunk->data(), local_chunk->size());
+						this->listener_.file_progress(file, static_cast<size_t>(sink.get_size()));
+						++i;
+						continue;
+					}
 
-	file_updater::file_updater(progress_listener& listener, std::filesystem::path base, std::filesystem::path process_file)
-		: listener_(listener)
-		, base_(std::move(base))
-		, process_file_(std::move(process_file))
-		, dead_process_file_(process_file_)
-	{
-		this->dead_process_file_.replace_extension(".exe.old");
-		this->delete_old_process_file();
-	}
+					// Adjacent missing chunks are fetched with a single range request
+					auto end = i;
+					size_t range_length = 0;
+					while (end < chunks.size() && !find_local_chunk(chunks[end])
+						&& (end == i || range_length + chunks[end].size <= CHUNKED_UPDATE_MAX_RANGE))
+					{
+						range_length += chunks[end].size;
+						++end;
+					}
 
-	void file_updater::run() const
-	{
-		const auto files = get_file_infos();
-		if (!files.empty())
-		{
-			this->cleanup_directories(files);
-		}
+					const auto range_start = chunks[i].offset;
+					const auto range = "bytes=" + std::to_string(range_start) + "-" + std::to_string(range_start + range_length - 1);
 
-		const auto outdated_files = this->get_outdated_files(files);
-		if (outdated_files.empty())
-		{
-			return;
-		}
+					const auto base_progress = static_cast<size_t>(sink.get_size());
+					range_sink range_data{range_length};
+					const auto result = utils::http::get_data(url, range_data, {{"Range", range}}, [&](const size_t progress)
+					{
+						this->listener_.file_progress(file, base_progress + progress);
+					});
 
-		this->update_host_binary(outdated_files);
-		this->update_files(outdated_files);
-	}
+					if (!result || range_data.get_data().size() != range_length)
+					{
+						throw std::runtime_error("Failed to fetch range " + range + " of " + url);
+					}
 
-	void file_updater::update_file(const file_info& file, bool iw4x_file) const
-	{
-		auto url = get_update_folder() + file.name;
-		utils::logger::write("Updating file {}", url);
+					const auto& data = range_data.get_data();
+					for (; i < end; ++i)
+					{
+						const auto& chunk = chunks[i];
+						const auto* chunk_data = data.data() + (chunk.offset - range_start);
 
-		if (iw4x_file)
-		{
-			url = file.name;
-			utils::logger::write("This is an iw4x file, the url has been changed to {} instead", url);
-		}
+						if (utils::cryptography::sha1::compute(reinterpret_cast<const uint8_t*>(chunk_data), chunk.size, true) != chunk.hash)
+						{
+							throw std::runtime_error("Chunk hash mismatch in " + url);
+						}
 
-		const auto data = utils::http::get_data(url, {}, [&](const size_t progress)
-		{
-			this->listener_.file_progress(file, progress);
-		});
+						sink.write(chunk_data, chunk.size);
+					}
+				}
+			}
 
-		// IW4x files have invalid hash and size for now
-		if (!data || (!iw4x_file && (data->size() != file.size || get_hash(*data) != file.hash)))
-		{
-			throw std::runtime_error("Failed to download: " + url);
-		}
+			if (sink.get_size() != file.size || sink.get_hash() != file.hash)
+			{
+				throw std::runtime_error("Rebuilt file does not match: " + file.name);
+			}
 
-		auto out_file = this->get_drive_filename(file);
+			sink.commit();
+			utils::logger::write("Rebuilt file {} from chunks", file.name);
 
-		// IW4x hack to fetch release from github
-		if (iw4x_file)
+			return true;
+		}
+		catch (const update_cancelled&)
 		{
-			out_file = this->base_ / std::filesystem::path(file.name).filename().string();
+			throw;
 		}
-
-		utils::logger::write("Writing file to {} ", out_file.string());
-
-		if (!utils::io::write_file(out_file, *data, false))
+		catch (const std::exception& e)
 		{
-			throw std::runtime_error("Failed to write: " + file.name);
+			utils::logger::write("Failed to rebuild file {}, falling back to a full download: {}", file.name, e.what());
+			return false;
 		}
-
-		utils::logger::write("Done updating file {}", file.name);
 	}
 
-	std::vector<file_info> file_updater::get_outdated_files(const std::vector<file_info>& files) const
+	std::filesystem::path file_updater::get_update_source(const file_info& file) const
 	{
-		std::vector<file_info> outdated_files{};
-
-		for (const auto& info : files)
-		{
-			if (this->is_outdated_file(info))
-			{
-				outdated_files.emplace_back(info);
-			}
-		}
-
-		return outdated_files;
+		// The host binary has already been moved aside at this point
+		return file.name == UPDATE_HOST_BINARY ? this->dead_process_file_ : this->get_drive_filename(file);
 	}
 
 	void file_updater::update_host_binary(const std::vector<file_info>& outdated_files) const
@@ -365,71 +1296,341 @@ namespace updater
 		}
 	}
 
-	void file_updater::update_files(const std::vector<file_info>& outdated_files, bool iw4x_files) const
+	std::uint64_t file_updater::get_segment_size() const
 	{
-		this->listener_.update_files(outdated_files);
+		const auto throughput = this->connection_throughput_.load();
+		if (!throughput)
+		{
+			return SEGMENT_DEFAULT_SIZE;
+		}
+
+		// Segments should take a few seconds, short enough to balance connections and long enough to amortize requests
+		return std::clamp(throughput * SEGMENT_TARGET_SECONDS, static_cast<std::uint64_t>(SEGMENT_MIN_SIZE),
+		                  static_cast<std::uint64_t>(SEGMENT_MAX_SIZE));
+	}
 
-		const auto thread_count = get_optimal_concurrent_download_count(outdated_files.size());
+	bool file_updater::try_download_segmented(const file_info& file, const std::string& url, const std::filesystem::path& out_file) const
+	{
+		if (file.size < SEGMENTED_DOWNLOAD_MIN_SIZE)
+		{
+			return false;
+		}
 
-		std::vector<std::thread> threads{};
-		std::atomic<size_t> current_index{0};
+		const auto connection_count = static_cast<size_t>(std::min(
+			static_cast<std::uint64_t>(SEGMENTED_DOWNLOAD_MAX_CONNECTIONS), file.size / this->get_segment_size()));
+		if (connection_count < 2)
+		{
+			return false;
+		}
 
-		utils::concurrency::container<std::exception_ptr> exception{};
+		utils::logger::write("Downloading file {} over {} connections", file.name, connection_count);
 
-		for (size_t i = 0; i < thread_count; ++i)
+		try
 		{
-			threads.emplace_back([&]()
+			const auto start = std::chrono::steady_clock::now();
+
+			utils::io::atomic_file out{out_file};
+			out.allocate(file.size);
+
+			std::mutex mutex{};
+			std::uint64_t next_offset = 0;
+			size_t segment_count = 0;
+
+			std::atomic<std::uint64_t> downloaded{0};
+			std::atomic<bool> failed{false};
+			utils::concurrency::container<std::exception_ptr> exception{};
+
+			// Segments are handed out on demand, so faster connections take more of them and their size follows the measured throughput
+			const auto next_segment = [&]() -> std::optional<std::pair<std::uint64_t, std::uint64_t>>
 			{
-				while (!exception.access<bool>([](const std::exception_ptr& ptr)
+				std::lock_guard<std::mutex> _{mutex};
+				if (failed || next_offset >= file.size)
 				{
-					return static_cast<bool>(ptr);
-				}))
+					return {};
+				}
+
+				const auto offset = next_offset;
+				const auto length = std::min(this->get_segment_size(), file.size - offset);
+
+				next_offset += length;
+				++segment_count;
+
+				return {{offset, length}};
+			};
+
+			const auto run_connection = [&]()
+			{
+				try
 				{
-					const auto index = current_index++;
-					if (index >= outdated_files.size())
+					while (const auto segment = next_segment())
 					{
-						break;
-					}
+						const auto [offset, length] = *segment;
+						const auto range = "bytes=" + std::to_string(offset) + "-" + std::to_string(offset + length - 1);
+						const auto segment_start = std::chrono::steady_clock::now();
 
-					try
-					{
-						const auto& file = outdated_files[index];
-						this->listener_.begin_file(file);
-						this->update_file(file, iw4x_files);
-						this->listener_.end_file(file);
+						segment_sink sink{out, offset, length, downloaded};
+						const auto result = utils::http::get_data(url, sink, {{"Range", range}}, [&](const size_t)
+						{
+							this->listener_.file_progress(file, static_cast<size_t>(downloaded.load()));
+						});
+
+						if (!result || sink.get_written() != length)
+						{
+							throw std::runtime_error("Failed to fetch range " + range + " of " + url);
+						}
+
+						const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+							std::chrono::steady_clock::now() - segment_start).count();
+						const auto throughput = (length * 1000) / std::max(static_cast<std::uint64_t>(elapsed), 1ull);
+
+						const auto previous = this->connection_throughput_.load();
+						this->connection_throughput_ = previous ? (previous * 3 + throughput) / 4 : throughput;
 					}
-					catch (...)
+				}
+				catch (...)
+				{
+					failed = true;
+					exception.access([](std::exception_ptr& ptr)
 					{
-						exception.access([](std::exception_ptr& ptr)
+						if (!ptr)
 						{
 							ptr = std::current_exception();
-						});
+						}
+					});
+				}
+			};
 
-						return;
-					}
+			std::vector<std::thread> threads{};
+			for (size_t i = 0; i < connection_count; ++i)
+			{
+				threads.emplace_back(run_connection);
+			}
+
+			// Update workers that ran out of files join in as additional connections
+			auto job = std::make_shared<segment_job>();
+			job->work = run_connection;
+
+			this->segment_jobs_.access([&job](std::vector<std::shared_ptr<segment_job>>& jobs)
+			{
+				jobs.emplace_back(job);
+			});
+
+			for (auto& thread : threads)
+			{
+				if (thread.joinable())
+				{
+					thread.join();
+				}
+			}
+
+			this->close_segment_job(job);
+
+			exception.access([](const std::exception_ptr& ptr)
+			{
+				if (ptr)
+				{
+					std::rethrow_exception(ptr);
 				}
 			});
+
+			// Segments only prove their length, the content is verified as a whole
+			utils::cryptography::sha1::context hash{};
+			out.read_contents([&hash](const std::string_view data)
+			{
+				hash.update(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+			});
+
+			if (hash.finalize(true) != file.hash)
+			{
+				throw std::runtime_error("Downloaded file does not match: " + file.name);
+			}
+
+			out.commit();
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+			utils::logger::write("Downloaded file {} in {} segments over {} connections in {}ms", file.name, segment_count,
+			                     connection_count, elapsed.count());
+
+			return true;
+		}
+		catch (const update_cancelled&)
+		{
+			throw;
+		}
+		catch (const std::exception& e)
+		{
+			utils::logger::write("Failed to download file {} in segments, falling back to a single connection: {}", file.name, e.what());
+			return false;
 		}
+	}
 
-		for (auto& thread : threads)
+	bool file_updater::help_segmented_download() const
+	{
+		const auto job = this->segment_jobs_.access<std::shared_ptr<segment_job>>([](const std::vector<std::shared_ptr<segment_job>>& jobs)
 		{
-			if (thread.joinable())
+			for (const auto& candidate : jobs)
 			{
-				thread.join();
+				std::lock_guard<std::mutex> _{candidate->mutex};
+				if (!candidate->closed && candidate->helpers < SEGMENTED_DOWNLOAD_MAX_CONNECTIONS)
+				{
+					++candidate->helpers;
+					return candidate;
+				}
 			}
+
+			return std::shared_ptr<segment_job>{};
+		});
+
+		if (!job)
+		{
+			return false;
+		}
+
+		job->work();
+
+		{
+			// The work only returns once no segments are left, so nobody else needs to join
+			std::lock_guard<std::mutex> _{job->mutex};
+			job->closed = true;
+			--job->helpers;
 		}
 
-		exception.access([](const std::exception_ptr& ptr)
+		job->finished.notify_all();
+		return true;
+	}
+
+	void file_updater::close_segment_job(const std::shared_ptr<segment_job>& job) const
+	{
+		this->segment_jobs_.access([&job](std::vector<std::shared_ptr<segment_job>>& jobs)
+		{
+			std::erase(jobs, job);
+		});
+
+		// Helpers reference the state of the running download, it must outlive them
+		std::unique_lock<std::mutex> lock{job->mutex};
+		job->closed = true;
+		job->finished.wait(lock, [&job]()
 		{
-			if (ptr)
+			return job->helpers == 0;
+		});
+	}
+
+	update_pipeline::stages file_updater::get_update_stages(const bool iw4x_files) const
+	{
+		update_pipeline::stages stages{};
+
+		stages.download = [this, iw4x_files](const file_info& file)
+		{
+			this->listener_.begin_file(file);
+			this->update_file(file, iw4x_files);
+		};
+
+		stages.help = [this]()
+		{
+			return this->help_segmented_download();
+		};
+
+		stages.commit = [this, iw4x_files](const file_info& file)
+		{
+			// IW4x files are written in place and aren't indexed
+			if (!iw4x_files && is_data_file(file))
+			{
+				this->journal_.stage(file);
+			}
+			else if (!iw4x_files)
 			{
-				std::rethrow_exception(ptr);
+				this->mark_committed(file, this->get_drive_filename(file));
 			}
+
+			this->listener_.end_file(file);
+		};
+
+		return stages;
+	}
+
+	void file_updater::update_files(const std::vector<file_info>& outdated_files, bool iw4x_files) const
+	{
+		this->listener_.update_files(outdated_files);
+
+		// Largest files first, so long transfers overlap with the small ones instead of running alone at the end
+		std::vector<const file_info*> order{};
+		order.reserve(outdated_files.size());
+		for (const auto& file : outdated_files)
+		{
+			order.emplace_back(&file);
+		}
+
+		std::ranges::stable_sort(order, [](const file_info* a, const file_info* b)
+		{
+			return a->size > b->size;
 		});
 
+		update_pipeline pipeline{get_optimal_concurrent_download_count(outdated_files.size()), this->get_update_stages(iw4x_files)};
+
+		for (const auto* file : order)
+		{
+			pipeline.push(*file);
+		}
+
+		pipeline.finish();
+
+		if (!iw4x_files)
+		{
+			this->commit_staged_files();
+		}
+
 		this->listener_.done_update();
 	}
 
+	void file_updater::commit_staged_files() const
+	{
+		this->journal_.commit([this](const std::string& name)
+		{
+			return this->get_drive_filename(file_info{name});
+		}, [this](const file_info& file, const std::filesystem::path& target)
+		{
+			this->mark_committed(file, target);
+		});
+	}
+
+	void file_updater::recover_staged_files() const
+	{
+		this->journal_.recover([this](const std::string& name)
+		{
+			return this->get_drive_filename(file_info{name});
+		}, [this](const file_info& file, const std::filesystem::path& target)
+		{
+			this->mark_committed(file, target);
+		});
+	}
+
+	void file_updater::mark_committed(const file_info& file, const std::filesystem::path& target) const
+	{
+		// Staged files were verified before they were recorded, moving them doesn't change that
+		const auto metadata = utils::io::get_file_metadata(target);
+		if (metadata)
+		{
+			this->file_index_.mark_verified(file, *metadata);
+		}
+
+		this->add_to_object_store(file, target);
+	}
+
+	void file_updater::add_to_object_store(const file_info& file, const std::filesystem::path& path) const
+	{
+		if (!is_data_file(file) || !this->object_store_.add(file, path))
+		{
+			return;
+		}
+
+		// The file was replaced by a link to the stored copy, which has its own file id
+		const auto metadata = utils::io::get_file_metadata(path);
+		if (metadata)
+		{
+			this->file_index_.mark_verified(file, *metadata);
+		}
+	}
+
 	bool file_updater::is_outdated_file(const file_info& file) const
 	{
 #ifndef CI_BUILD
@@ -439,20 +1640,31 @@ namespace updater
 		}
 #endif
 
-		std::string data{};
 		const auto drive_name = this->get_drive_filename(file);
-		if (!utils::io::read_file(drive_name, &data))
+		const auto metadata = utils::io::get_file_metadata(drive_name);
+		if (!metadata || metadata->size != file.size)
 		{
+			this->file_index_.invalidate(file);
 			return true;
 		}
 
-		if (data.size() != file.size)
+		if (this->file_index_.is_verified(file, *metadata))
+		{
+			this->add_to_object_store(file, drive_name);
+			return false;
+		}
+
+		// Only files of matching size are hashed, directly from a mapping of the file
+		if (!is_file_hash_valid(file, drive_name))
 		{
+			this->file_index_.invalidate(file);
 			return true;
 		}
 
-		const auto hash = get_hash(data);
-		return hash != file.hash;
+		// The metadata was taken before reading, so a concurrent modification only causes another verification
+		this->file_index_.mark_verified(file, *metadata);
+		this->add_to_object_store(file, drive_name);
+		return false;
 	}
 
 	std::filesystem::path file_updater::get_drive_filename(const file_info& file) const
@@ -490,7 +1702,7 @@ namespace updater
 		}
 	}
 
-	void file_updater::cleanup_directories(const std::vector<file_info>& files) const
+	void file_updater::cleanup_directories(const binary_manifest& manifest) const
 	{
 		if (!utils::io::directory_exists(this->base_))
 		{
@@ -498,26 +1710,26 @@ namespace updater
 		}
 
 		this->cleanup_root_directory();
-		this->cleanup_data_directory(files);
+		this->cleanup_data_directory(manifest);
 	}
 
 	void file_updater::cleanup_root_directory() const
 	{
-		const auto existing_files = utils::io::list_files(this->base_);
-		for (const auto& file : existing_files)
+		utils::io::directory_walker walker{this->base_, false};
+		for (const auto& entry : walker)
 		{
-			const auto entry = std::filesystem::relative(file, this->base_);
-			if ((entry.string() == "user" || entry.string() == "data") && utils::io::directory_exists(file))
+			const auto name = entry.path.filename();
+			if ((name == "user" || name == "data") && entry.is_directory)
 			{
 				continue;
 			}
 
 			std::error_code code{};
-			std::filesystem::remove_all(file, code);
+			std::filesystem::remove_all(entry.path, code);
 		}
 	}
 
-	void file_updater::cleanup_data_directory(const std::vector<file_info>& files) const
+	void file_updater::cleanup_data_directory(const binary_manifest& manifest) const
 	{
 		const auto base = std::filesystem::path(this->base_) / "data";
 		if (!utils::io::directory_exists(base.string()))
@@ -525,44 +1737,40 @@ namespace updater
 			return;
 		}
 
-		std::vector<std::filesystem::path> legal_files{};
-		legal_files.reserve(files.size());
-		for (const auto& file : files)
+		const auto start = std::chrono::steady_clock::now();
+		const auto table = get_data_path_table(manifest);
+
+		const auto get_type = [&](const utils::io::directory_entry& entry)
 		{
-			if (file.name != UPDATE_HOST_BINARY)
-			{
-				legal_files.emplace_back(std::filesystem::absolute(base / file.name));
-			}
-		}
+			return table.get_type(entry.path.lexically_relative(base).generic_string());
+		};
 
-		const auto existing_files = utils::io::list_files(base.string(), true);
-		for (auto& file : existing_files)
+		// Folders that are removed as a whole aren't walked at all, everything else is classified while the walk goes on
+		utils::io::directory_walker walker{base, true, [&get_type](const utils::io::directory_entry& entry)
 		{
-			const auto is_file = std::filesystem::is_regular_file(file);
-			const auto is_folder = std::filesystem::is_directory(file);
+			return get_type(entry) == data_path_table::entry_type::folder;
+		}};
 
-			if (is_file || is_folder)
-			{
-				bool is_legal = false;
+		size_t checked_count = 0;
+		size_t removed_count = 0;
 
-				for (const auto& legal_file : legal_files)
-				{
-					if ((is_folder && is_inside_folder(legal_file, file)) ||
-						(is_file && legal_file == file))
-					{
-						is_legal = true;
-						break;
-					}
-				}
+		for (const auto& entry : walker)
+		{
+			++checked_count;
 
-				if (is_legal)
-				{
-					continue;
-				}
+			const auto type = get_type(entry);
+			if (type == (entry.is_directory ? data_path_table::entry_type::folder : data_path_table::entry_type::file))
+			{
+				continue;
 			}
 
 			std::error_code code{};
-			std::filesystem::remove_all(file, code);
+			std::filesystem::remove_all(entry.path, code);
+			++removed_count;
 		}
+
+		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		utils::logger::write("Checked {} entries in the data folder in {}ms, removed {}", checked_count, duration.count(),
+		                     removed_count);
 	}
 }
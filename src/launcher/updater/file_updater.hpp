@@ -1,6 +1,12 @@
 #pragma once
 
 #include "progress_listener.hpp"
+#include "file_index.hpp"
+#include "manifest_cache.hpp"
+#include "binary_manifest.hpp"
+#include "update_pipeline.hpp"
+#include "update_journal.hpp"
+#include "object_store.hpp"
 
 namespace updater
 {
@@ -11,8 +17,6 @@ namespace updater
 
 		void run() const;
 
-		[[nodiscard]] std::vector<file_info> get_outdated_files(const std::vector<file_info>& files) const;
-
 		void update_host_binary(const std::vector<file_info>& outdated_files) const;
 
 		void update_iw4x_if_necessary() const;
@@ -32,7 +36,39 @@ namespace updater
 		std::filesystem::path process_file_;
 		std::filesystem::path dead_process_file_;
 
+		mutable file_index file_index_;
+		mutable manifest_cache manifest_cache_;
+		mutable update_journal journal_;
+		object_store object_store_;
+
+		// Bytes per second a single connection achieved for the last segments, sizes the next segments
+		mutable std::atomic<std::uint64_t> connection_throughput_{0};
+
+		// A running segmented download that idle update workers can join as additional connections
+		struct segment_job
+		{
+			std::function<void()> work{};
+			std::mutex mutex{};
+			std::condition_variable finished{};
+			size_t helpers{};
+			bool closed{};
+		};
+
+		mutable utils::concurrency::container<std::vector<std::shared_ptr<segment_job>>> segment_jobs_{};
+
+		[[nodiscard]] update_pipeline::stages get_update_stages(bool iw4x_files) const;
 		void update_file(const file_info& file, bool iw4x_files = false) const;
+		void commit_staged_files() const;
+		void recover_staged_files() const;
+		void mark_committed(const file_info& file, const std::filesystem::path& target) const;
+		void add_to_object_store(const file_info& file, const std::filesystem::path& path) const;
+		[[nodiscard]] bool try_patch_file(const file_info& file, const std::filesystem::path& out_file) const;
+		[[nodiscard]] bool try_rebuild_file(const file_info& file, const std::filesystem::path& out_file) const;
+		[[nodiscard]] bool try_download_segmented(const file_info& file, const std::string& url, const std::filesystem::path& out_file) const;
+		[[nodiscard]] std::uint64_t get_segment_size() const;
+		[[nodiscard]] bool help_segmented_download() const;
+		void close_segment_job(const std::shared_ptr<segment_job>& job) const;
+		[[nodiscard]] std::filesystem::path get_update_source(const file_info& file) const;
 
 		[[nodiscard]] bool is_outdated_file(const file_info& file) const;
 		[[nodiscard]] std::filesystem::path get_drive_filename(const file_info& file) const;
@@ -47,8 +83,8 @@ namespace updater
 		bool does_iw4x_require_update(iw4x_update_state& update_state) const;
 		void deploy_iw4x_rawfiles() const;
 
-		void cleanup_directories(const std::vector<file_info>& files) const;
+		void cleanup_directories(const binary_manifest& manifest) const;
 		void cleanup_root_directory() const;
-		void cleanup_data_directory(const std::vector<file_info>& files) const;
+		void cleanup_data_directory(const binary_manifest& manifest) const;
 	};
 }
@@ -0,0 +1,243 @@
+#include <std_include.hpp>
+
+#include "manifest_cache.hpp"
+
+#include <utils/flags.hpp>
+#include <utils/logger.hpp>
+
+#include <rapidjson/writer.h>
+
+#define MANIFEST_CACHE_VERSION 1
+
+namespace updater
+{
+	namespace
+	{
+		bool write_atomically(const std::filesystem::path& file, const std::string& data)
+		{
+			auto temp_file = file;
+			temp_file += ".tmp";
+
+			if (!utils::io::write_file(temp_file, data) || !utils::io::move_file(temp_file, file, true))
+			{
+				utils::io::remove_file(temp_file);
+				return false;
+			}
+
+			return true;
+		}
+
+		// Keeps the body in memory and forwards it as it arrives, retries continue where the data stopped
+		class streaming_sink : public utils::http::data_sink
+		{
+		public:
+			streaming_sink(const std::function<void(std::string_view)>& on_data)
+				: on_data_(on_data)
+			{
+			}
+
+			void reset() override
+			{
+				if (!this->buffer.empty() && this->on_data_)
+				{
+					throw std::runtime_error("Manifest transfer restarted after its data was already passed on");
+				}
+
+				this->buffer.clear();
+			}
+
+			void write(const char* data, const size_t length) override
+			{
+				this->buffer.append(data, length);
+
+				if (this->on_data_)
+				{
+					this->on_data_(std::string_view(data, length));
+				}
+			}
+
+			std::uint64_t get_resume_offset() const override
+			{
+				return this->buffer.size();
+			}
+
+			std::string buffer{};
+
+		private:
+			const std::function<void(std::string_view)>& on_data_;
+		};
+
+		std::string get_header(const utils::http::response_info& response, const std::string& name)
+		{
+			const auto header = response.response_headers.find(name);
+			return header == response.response_headers.end() ? std::string{} : header->second;
+		}
+	}
+
+	manifest_cache::manifest_cache(std::filesystem::path folder)
+		: state_file_(folder / "manifest-cache.json")
+		, data_file_(folder / "manifest-cache.data")
+		, binary_file_(std::move(folder) / "manifest-cache.bin")
+	{
+	}
+
+	void manifest_cache::load()
+	{
+		std::string data{};
+		if (!utils::io::read_file(this->state_file_, &data))
+		{
+			return;
+		}
+
+		rapidjson::Document doc{};
+		const rapidjson::ParseResult result = doc.Parse(data);
+
+		if (!result || !doc.IsObject() || !doc.HasMember("version") || !doc["version"].IsInt()
+			|| doc["version"].GetInt() != MANIFEST_CACHE_VERSION)
+		{
+			utils::logger::write("Discarding invalid manifest cache {}", this->state_file_.string());
+			return;
+		}
+
+		const auto get_string = [&doc](const char* name)
+		{
+			if (!doc.HasMember(name) || !doc[name].IsString())
+			{
+				return std::string{};
+			}
+
+			return std::string(doc[name].GetString(), doc[name].GetStringLength());
+		};
+
+		this->url_ = get_string("url");
+		this->etag_ = get_string("etag");
+		this->last_modified_ = get_string("last_modified");
+
+		if (doc.HasMember("verified_files") && doc["verified_files"].IsUint64())
+		{
+			this->verified_files_ = static_cast<size_t>(doc["verified_files"].GetUint64());
+		}
+	}
+
+	std::optional<std::string> manifest_cache::fetch(const std::string& url, const std::function<void(std::string_view)>& on_data)
+	{
+		this->unchanged_ = false;
+
+		utils::http::headers headers{};
+		if (this->url_ == url && utils::io::file_exists(this->data_file_.wstring()))
+		{
+			if (!this->etag_.empty())
+			{
+				headers["If-None-Match"] = this->etag_;
+			}
+
+			if (!this->last_modified_.empty())
+			{
+				headers["If-Modified-Since"] = this->last_modified_;
+			}
+		}
+
+		utils::http::response_info response{};
+		streaming_sink sink{on_data};
+		if (!utils::http::get_data(url, sink, headers, {}, 2, &response))
+		{
+			return {};
+		}
+
+		std::optional<std::string> data{std::move(sink.buffer)};
+
+		if (response.status_code == 304 && !headers.empty())
+		{
+			std::string cached_data{};
+			if (utils::io::read_file(this->data_file_, &cached_data))
+			{
+				utils::logger::write("Manifest {} is unchanged", url);
+				this->unchanged_ = true;
+				return {std::move(cached_data)};
+			}
+
+			// The cache vanished in the meantime, ask again without validators
+			this->url_.clear();
+			return this->fetch(url, on_data);
+		}
+
+		this->url_ = url;
+		this->etag_ = get_header(response, "etag");
+		this->last_modified_ = get_header(response, "last-modified");
+		this->verified_files_ = {};
+
+		// The compact copy belongs to the previous manifest
+		utils::io::remove_file(this->binary_file_);
+
+		if (!write_atomically(this->data_file_, *data))
+		{
+			utils::logger::write("Failed to write manifest cache {}", this->data_file_.string());
+			this->url_.clear();
+		}
+
+		this->save();
+
+		return data;
+	}
+
+	bool manifest_cache::is_unchanged() const
+	{
+		return this->unchanged_;
+	}
+
+	bool manifest_cache::is_verified(const size_t file_count) const
+	{
+		return this->unchanged_ && this->verified_files_ == file_count && !utils::flags::has_flag("verify");
+	}
+
+	void manifest_cache::mark_verified(const size_t file_count)
+	{
+		if (this->verified_files_ == file_count || this->url_.empty())
+		{
+			return;
+		}
+
+		this->verified_files_ = file_count;
+		this->save();
+	}
+
+	const std::filesystem::path& manifest_cache::get_binary_file() const
+	{
+		return this->binary_file_;
+	}
+
+	void manifest_cache::store_binary(const std::string& data) const
+	{
+		if (!this->url_.empty() && !write_atomically(this->binary_file_, data))
+		{
+			utils::logger::write("Failed to write manifest cache {}", this->binary_file_.string());
+		}
+	}
+
+	void manifest_cache::save() const
+	{
+		rapidjson::Document doc{};
+		doc.SetObject();
+
+		auto& allocator = doc.GetAllocator();
+
+		doc.AddMember("version", MANIFEST_CACHE_VERSION, allocator);
+		doc.AddMember("url", rapidjson::Value(this->url_, allocator), allocator);
+		doc.AddMember("etag", rapidjson::Value(this->etag_, allocator), allocator);
+		doc.AddMember("last_modified", rapidjson::Value(this->last_modified_, allocator), allocator);
+
+		if (this->verified_files_)
+		{
+			doc.AddMember("verified_files", static_cast<uint64_t>(*this->verified_files_), allocator);
+		}
+
+		rapidjson::StringBuffer buffer{};
+		rapidjson::Writer<rapidjson::StringBuffer, rapidjson::Document::EncodingType, rapidjson::ASCII<>> writer(buffer);
+		doc.Accept(writer);
+
+		if (!write_atomically(this->state_file_, std::string(buffer.GetString(), buffer.GetSize())))
+		{
+			utils::logger::write("Failed to write manifest cache {}", this->state_file_.string());
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <utils/http.hpp>
+
+namespace updater
+{
+	// Keeps the last manifest together with its validators, so an unchanged manifest only costs a 304.
+	// It also remembers whether all files were verified against that manifest, which allows skipping the update entirely.
+	class manifest_cache
+	{
+	public:
+		manifest_cache(std::filesystem::path folder);
+
+		void load();
+
+		// Returns the manifest, either freshly downloaded or from the cache if the server reports it as unchanged.
+		// Downloaded data is also passed to the callback while it arrives, data from the cache is not.
+		[[nodiscard]] std::optional<std::string> fetch(const std::string& url,
+		                                               const std::function<void(std::string_view)>& on_data = {});
+
+		[[nodiscard]] bool is_unchanged() const;
+		[[nodiscard]] bool is_verified(size_t file_count) const;
+		void mark_verified(size_t file_count);
+
+		// Compact copy of the cached manifest, which spares parsing it again while it is unchanged, see binary_manifest
+		[[nodiscard]] const std::filesystem::path& get_binary_file() const;
+		void store_binary(const std::string& data) const;
+
+	private:
+		std::filesystem::path state_file_;
+		std::filesystem::path data_file_;
+		std::filesystem::path binary_file_;
+
+		std::string url_{};
+		std::string etag_{};
+		std::string last_modified_{};
+		std::optional<size_t> verified_files_{};
+		bool unchanged_{};
+
+		void save() const;
+	};
+}
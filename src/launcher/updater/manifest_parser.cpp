@@ -0,0 +1,492 @@
+#include <std_include.hpp>
+
+#include "manifest_parser.hpp"
+
+#include <utils/logger.hpp>
+#include <utils/string.hpp>
+
+#include <rapidjson/reader.h>
+
+namespace updater
+{
+	namespace
+	{
+		// rapidjson input stream over chunks that are handed out one by one, blocking until the next one arrives
+		class chunk_stream
+		{
+		public:
+			using Ch = char;
+
+			chunk_stream(std::function<std::optional<std::string>()> next_chunk)
+				: next_chunk_(std::move(next_chunk))
+			{
+			}
+
+			Ch Peek()
+			{
+				return this->fill() ? this->chunk_[this->position_] : '\0';
+			}
+
+			Ch Take()
+			{
+				if (!this->fill())
+				{
+					return '\0';
+				}
+
+				++this->offset_;
+				return this->chunk_[this->position_++];
+			}
+
+			size_t Tell() const
+			{
+				return this->offset_;
+			}
+
+			Ch* PutBegin()
+			{
+				assert(false);
+				return nullptr;
+			}
+
+			void Put(Ch)
+			{
+				assert(false);
+			}
+
+			void Flush()
+			{
+				assert(false);
+			}
+
+			size_t PutEnd(Ch*)
+			{
+				assert(false);
+				return 0;
+			}
+
+		private:
+			std::function<std::optional<std::string>()> next_chunk_;
+			std::string chunk_{};
+			size_t position_{};
+			size_t offset_{};
+
+			bool fill()
+			{
+				while (this->position_ >= this->chunk_.size())
+				{
+					auto chunk = this->next_chunk_();
+					if (!chunk)
+					{
+						return false;
+					}
+
+					this->chunk_ = std::move(*chunk);
+					this->position_ = 0;
+				}
+
+				return true;
+			}
+		};
+
+		// [[name, size, hash, tree_hash?, [[from_hash, size, hash], ...]?, [codec, compressed_size]?], ...]
+		class manifest_handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, manifest_handler>
+		{
+		public:
+			manifest_handler(const std::function<void(file_info&&)>& callback)
+				: callback_(callback)
+			{
+			}
+
+			bool Null()
+			{
+				return this->value({});
+			}
+
+			bool Bool(bool)
+			{
+				return this->value({});
+			}
+
+			bool Int(const int number)
+			{
+				return this->value(number >= 0 ? std::optional<uint64_t>(static_cast<uint64_t>(number)) : std::nullopt);
+			}
+
+			bool Uint(const unsigned number)
+			{
+				return this->value(std::optional<uint64_t>(number));
+			}
+
+			bool Int64(const int64_t number)
+			{
+				return this->value(number >= 0 ? std::optional<uint64_t>(static_cast<uint64_t>(number)) : std::nullopt);
+			}
+
+			bool Uint64(const uint64_t number)
+			{
+				return this->value(std::optional<uint64_t>(number));
+			}
+
+			bool Double(double)
+			{
+				return this->value({});
+			}
+
+			bool String(const char* str, const rapidjson::SizeType length, bool)
+			{
+				return this->value({}, std::string_view(str, length));
+			}
+
+			bool StartObject()
+			{
+				return this->start(false);
+			}
+
+			bool Key(const char*, rapidjson::SizeType, bool)
+			{
+				return true;
+			}
+
+			bool EndObject(rapidjson::SizeType)
+			{
+				return this->end();
+			}
+
+			bool StartArray()
+			{
+				return this->start(true);
+			}
+
+			bool EndArray(rapidjson::SizeType)
+			{
+				return this->end();
+			}
+
+			[[nodiscard]] size_t get_skipped_count() const
+			{
+				return this->skipped_;
+			}
+
+		private:
+			enum class context
+			{
+				root,
+				files,
+				entry,
+				patches,
+				patch,
+				compressed,
+				skip,
+			};
+
+			const std::function<void(file_info&&)>& callback_;
+			std::vector<context> stack_{context::root};
+
+			file_info file_{};
+			size_t field_{};
+			bool valid_{};
+
+			patch_info patch_{};
+			std::string codec_{};
+			size_t compressed_size_{};
+			size_t inner_field_{};
+			bool inner_valid_{};
+
+			size_t skipped_{};
+
+			bool value(const std::optional<uint64_t> number, const std::optional<std::string_view> string = {})
+			{
+				switch (this->stack_.back())
+				{
+				case context::root:
+					return false;
+				case context::files:
+					++this->skipped_;
+					return true;
+				case context::entry:
+					this->entry_value(number, string);
+					return true;
+				case context::patch:
+				case context::compressed:
+					this->inner_value(number, string);
+					return true;
+				default:
+					return true;
+				}
+			}
+
+			void entry_value(const std::optional<uint64_t>& number, const std::optional<std::string_view>& string)
+			{
+				const auto field = this->field_++;
+
+				if (field == 0 && string && !string->empty())
+				{
+					this->file_.name = *string;
+				}
+				else if (field == 1 && number)
+				{
+					this->file_.size = static_cast<size_t>(*number);
+				}
+				else if (field == 2 && string && !string->empty())
+				{
+					this->file_.hash = *string;
+				}
+				else if (field == 3 && string)
+				{
+					this->file_.tree_hash = utils::string::to_upper(std::string(*string));
+				}
+				else if (field <= 2)
+				{
+					this->valid_ = false;
+				}
+			}
+
+			void inner_value(const std::optional<uint64_t>& number, const std::optional<std::string_view>& string)
+			{
+				const auto field = this->inner_field_++;
+				const auto is_patch = this->stack_.back() == context::patch;
+
+				if (field == 0 && string)
+				{
+					if (is_patch)
+					{
+						this->patch_.from_hash = utils::string::to_upper(std::string(*string));
+					}
+					else
+					{
+						this->codec_ = utils::string::to_lower(std::string(*string));
+					}
+				}
+				else if (field == 1 && number)
+				{
+					if (is_patch)
+					{
+						this->patch_.size = static_cast<size_t>(*number);
+					}
+					else
+					{
+						this->compressed_size_ = static_cast<size_t>(*number);
+					}
+				}
+				else if (field == 2 && string && is_patch)
+				{
+					this->patch_.hash = utils::string::to_upper(std::string(*string));
+				}
+				else if (field <= (is_patch ? 2u : 1u))
+				{
+					this->inner_valid_ = false;
+				}
+			}
+
+			bool start(const bool is_array)
+			{
+				const auto current = this->stack_.back();
+
+				if (current == context::root)
+				{
+					if (!is_array)
+					{
+						return false;
+					}
+
+					this->stack_.emplace_back(context::files);
+					return true;
+				}
+
+				if (current == context::files && is_array)
+				{
+					this->file_ = {};
+					this->field_ = 0;
+					this->valid_ = true;
+					this->stack_.emplace_back(context::entry);
+					return true;
+				}
+
+				if (current == context::entry)
+				{
+					const auto field = this->field_++;
+					if (is_array && (field == 4 || field == 5))
+					{
+						this->codec_.clear();
+						this->compressed_size_ = 0;
+						this->inner_field_ = 0;
+						this->inner_valid_ = true;
+						this->stack_.emplace_back(field == 4 ? context::patches : context::compressed);
+						return true;
+					}
+
+					if (field <= 2)
+					{
+						this->valid_ = false;
+					}
+				}
+				else if (current == context::patches && is_array)
+				{
+					this->patch_ = {};
+					this->inner_field_ = 0;
+					this->inner_valid_ = true;
+					this->stack_.emplace_back(context::patch);
+					return true;
+				}
+				else if (current == context::files)
+				{
+					++this->skipped_;
+				}
+				else if (current == context::patch || current == context::compressed)
+				{
+					this->inner_valid_ = false;
+					++this->inner_field_;
+				}
+
+				// Anything unexpected is skipped as a whole, including everything nested inside it
+				this->stack_.emplace_back(context::skip);
+				return true;
+			}
+
+			bool end()
+			{
+				const auto current = this->stack_.back();
+				this->stack_.pop_back();
+
+				if (current == context::entry)
+				{
+					if (this->valid_ && this->field_ >= 3)
+					{
+						this->callback_(std::move(this->file_));
+					}
+					else
+					{
+						++this->skipped_;
+					}
+				}
+				else if (current == context::patch)
+				{
+					if (this->inner_valid_ && this->inner_field_ >= 3)
+					{
+						this->file_.patches.emplace_back(std::move(this->patch_));
+					}
+				}
+				else if (current == context::compressed)
+				{
+					if (this->inner_valid_ && this->inner_field_ >= 2)
+					{
+						this->file_.codec = this->codec_;
+						this->file_.compressed_size = this->compressed_size_;
+					}
+				}
+
+				return true;
+			}
+		};
+	}
+
+	manifest_parser::manifest_parser(std::function<void(file_info&&)> callback)
+		: callback_(std::move(callback))
+	{
+	}
+
+	manifest_parser::~manifest_parser()
+	{
+		this->finish();
+	}
+
+	void manifest_parser::write(const std::string_view data)
+	{
+		if (data.empty())
+		{
+			return;
+		}
+
+		if (!this->thread_.joinable())
+		{
+			this->thread_ = std::thread([this]()
+			{
+				this->parse();
+			});
+		}
+
+		this->written_size_ += data.size();
+
+		this->input_.access([&data](input_queue& queue)
+		{
+			queue.chunks.emplace_back(data);
+		});
+
+		this->input_event_.notify_one();
+	}
+
+	bool manifest_parser::finish()
+	{
+		if (!this->thread_.joinable())
+		{
+			return false;
+		}
+
+		this->input_.access([](input_queue& queue)
+		{
+			queue.finished = true;
+		});
+
+		this->input_event_.notify_one();
+		this->thread_.join();
+
+		return this->result_;
+	}
+
+	size_t manifest_parser::get_written_size() const
+	{
+		return this->written_size_;
+	}
+
+	std::optional<std::string> manifest_parser::read_chunk()
+	{
+		return this->input_.access_with_lock<std::optional<std::string>>(
+			[this](input_queue& queue, std::unique_lock<std::mutex>& lock) -> std::optional<std::string>
+			{
+				this->input_event_.wait(lock, [&queue]()
+				{
+					return !queue.chunks.empty() || queue.finished;
+				});
+
+				if (queue.chunks.empty())
+				{
+					return {};
+				}
+
+				auto chunk = std::move(queue.chunks.front());
+				queue.chunks.pop_front();
+				return {std::move(chunk)};
+			});
+	}
+
+	void manifest_parser::parse()
+	{
+		manifest_handler handler{this->callback_};
+		chunk_stream stream{[this]()
+		{
+			return this->read_chunk();
+		}};
+
+		rapidjson::Reader reader{};
+		const rapidjson::ParseResult result = reader.Parse(stream, handler);
+
+		// Drain whatever is left, so the writer never waits on a parser that already gave up
+		while (this->read_chunk())
+		{
+		}
+
+		if (!result)
+		{
+			utils::logger::write("Failed to parse manifest at offset {}: error {}", result.Offset(), static_cast<int>(result.Code()));
+			return;
+		}
+
+		if (handler.get_skipped_count() > 0)
+		{
+			utils::logger::write("Skipped {} malformed manifest entries", handler.get_skipped_count());
+		}
+
+		this->result_ = true;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "file_info.hpp"
+
+#include <utils/concurrency.hpp>
+
+namespace updater
+{
+	// Turns manifest entries into file_info records while the manifest is still arriving, without building a DOM.
+	// Malformed entries are skipped, only a broken overall structure fails the parse.
+	class manifest_parser
+	{
+	public:
+		manifest_parser(std::function<void(file_info&&)> callback);
+		~manifest_parser();
+
+		manifest_parser(manifest_parser&&) = delete;
+		manifest_parser(const manifest_parser&) = delete;
+		manifest_parser& operator=(manifest_parser&&) = delete;
+		manifest_parser& operator=(const manifest_parser&) = delete;
+
+		// Parsing happens on a separate thread that consumes the written data as it becomes available
+		void write(std::string_view data);
+
+		// Waits for the parser and returns whether the manifest was well-formed
+		bool finish();
+
+		[[nodiscard]] size_t get_written_size() const;
+
+	private:
+		struct input_queue
+		{
+			std::deque<std::string> chunks{};
+			bool finished{};
+		};
+
+		std::function<void(file_info&&)> callback_;
+
+		utils::concurrency::container<input_queue> input_{};
+		std::condition_variable input_event_{};
+
+		std::thread thread_{};
+		std::atomic<bool> result_{false};
+		size_t written_size_{};
+
+		void parse();
+		std::optional<std::string> read_chunk();
+	};
+}
@@ -0,0 +1,133 @@
+#include <std_include.hpp>
+
+#include "object_store.hpp"
+
+#include <utils/io.hpp>
+#include <utils/logger.hpp>
+
+#define OBJECT_STORE_FOLDER ".objects"
+
+namespace updater
+{
+	object_store::object_store(std::filesystem::path data_folder, verifier verify)
+		: data_folder_(std::move(data_folder))
+		, verify_(std::move(verify))
+	{
+	}
+
+	std::string object_store::get_object_name(const std::string_view hash)
+	{
+		// The hash comes from the manifest and ends up in a path, so it must not be able to leave the store
+		if (hash.size() < 2 || !std::ranges::all_of(hash, [](const char c)
+		{
+			return std::isalnum(static_cast<unsigned char>(c)) != 0;
+		}))
+		{
+			return {};
+		}
+
+		// Objects are spread over subfolders by their first two characters, which keeps the folders small
+		return std::string(OBJECT_STORE_FOLDER "/").append(hash.substr(0, 2)).append("/").append(hash);
+	}
+
+	bool object_store::add(const file_info& file, const std::filesystem::path& path) const
+	{
+		const auto object = this->get_object_file(file.hash);
+		if (!object)
+		{
+			return false;
+		}
+
+		const auto object_metadata = utils::io::get_file_metadata(*object);
+		if (!object_metadata)
+		{
+			std::error_code code{};
+			std::filesystem::create_directories(object->parent_path(), code);
+
+			// Failing is fine, e.g. on file systems without hard links, the file just isn't shared then
+			CreateHardLinkW(object->wstring().data(), path.wstring().data(), nullptr);
+			return false;
+		}
+
+		const auto file_metadata = utils::io::get_file_metadata(path);
+		if (!file_metadata || (file_metadata->file_id == object_metadata->file_id
+			&& file_metadata->volume_serial == object_metadata->volume_serial))
+		{
+			return false;
+		}
+
+		// The same content is stored twice, the object is checked first as it could have been modified through another link
+		if (object_metadata->size != file.size || !this->verify_(file, *object) || !link(*object, path, false))
+		{
+			return false;
+		}
+
+		utils::logger::write("Replaced {} with a link to the identical stored file", file.name);
+		return true;
+	}
+
+	bool object_store::extract(const file_info& file, const std::filesystem::path& path) const
+	{
+		const auto object = this->get_object_file(file.hash);
+		if (!object)
+		{
+			return false;
+		}
+
+		const auto metadata = utils::io::get_file_metadata(*object);
+		if (!metadata || metadata->size != file.size)
+		{
+			return false;
+		}
+
+		// Editing any link modifies the object as well, such an object is dropped and the file fetched again
+		if (!this->verify_(file, *object))
+		{
+			utils::logger::write("Removing modified object {}", object->string());
+			utils::io::remove_file(*object);
+			return false;
+		}
+
+		return link(*object, path, true);
+	}
+
+	std::optional<std::filesystem::path> object_store::get_object_file(const std::string& hash) const
+	{
+		const auto name = get_object_name(hash);
+		if (name.empty())
+		{
+			return {};
+		}
+
+		return {this->data_folder_ / name};
+	}
+
+	bool object_store::link(const std::filesystem::path& object, const std::filesystem::path& path, const bool allow_copy)
+	{
+		if (path.has_parent_path())
+		{
+			std::error_code code{};
+			std::filesystem::create_directories(path.parent_path(), code);
+		}
+
+		// The link is created next to the target and then replaces it in a single step
+		auto temp_file = path;
+		temp_file += ".link";
+		utils::io::remove_file(temp_file);
+
+		// File systems without hard links still save the download with a copy
+		if (!CreateHardLinkW(temp_file.wstring().data(), object.wstring().data(), nullptr)
+			&& (!allow_copy || !CopyFileW(object.wstring().data(), temp_file.wstring().data(), FALSE)))
+		{
+			return false;
+		}
+
+		if (!utils::io::move_file(temp_file, path, true))
+		{
+			utils::io::remove_file(temp_file);
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "file_info.hpp"
+
+namespace updater
+{
+	// Keeps one copy of every file content in the data folder under .objects, named by its hash.
+	// Files in the data folder are hard links to these objects, so identical files share their storage and content
+	// that is stored already never has to be downloaded again, no matter which name it has in the manifest.
+	class object_store
+	{
+	public:
+		using verifier = std::function<bool(const file_info& file, const std::filesystem::path& path)>;
+
+		object_store(std::filesystem::path data_folder, verifier verify);
+
+		// Relative to the data folder, empty for hashes that can't name an object
+		[[nodiscard]] static std::string get_object_name(std::string_view hash);
+
+		// Adds a verified file, a file whose content is stored already is replaced by a link to the object instead.
+		// Returns whether the file itself was replaced.
+		bool add(const file_info& file, const std::filesystem::path& path) const;
+
+		// Creates the file from the store, returns false if the store holds no valid object for it
+		bool extract(const file_info& file, const std::filesystem::path& path) const;
+
+	private:
+		std::filesystem::path data_folder_;
+		verifier verify_;
+
+		[[nodiscard]] std::optional<std::filesystem::path> get_object_file(const std::string& hash) const;
+		static bool link(const std::filesystem::path& object, const std::filesystem::path& path, bool allow_copy);
+	};
+}
@@ -10,6 +10,9 @@ namespace updater
 		virtual ~progress_listener() = default;
 
 		virtual void update_files(const std::vector<file_info>& files) = 0;
+
+		// A file that was found outdated while the update is already running
+		virtual void add_file(const file_info& file) = 0;
 		virtual void done_update() = 0;
 
 		virtual void begin_file(const file_info& file) = 0;
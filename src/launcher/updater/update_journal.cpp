@@ -0,0 +1,290 @@
+#include <std_include.hpp>
+
+#include "update_journal.hpp"
+
+#include <utils/logger.hpp>
+
+#include <charconv>
+
+// One record per line: "S <hash> <size> <name>" for a staged file and "C" for the start of the commit
+#define JOURNAL_STAGED_RECORD 'S'
+#define JOURNAL_COMMIT_RECORD 'C'
+
+namespace updater
+{
+	namespace
+	{
+		std::string get_staged_record(const file_info& file)
+		{
+			return std::string(1, JOURNAL_STAGED_RECORD) + " " + file.hash + " " + std::to_string(file.size) + " " + file.name + "\n";
+		}
+
+		std::optional<file_info> parse_staged_record(const std::string_view record)
+		{
+			if (record.size() < 3 || record[0] != JOURNAL_STAGED_RECORD || record[1] != ' ')
+			{
+				return {};
+			}
+
+			const auto hash_end = record.find(' ', 2);
+			const auto size_end = hash_end == std::string_view::npos ? hash_end : record.find(' ', hash_end + 1);
+			if (size_end == std::string_view::npos)
+			{
+				return {};
+			}
+
+			file_info file{};
+			const auto* size_start = record.data() + hash_end + 1;
+			const auto result = std::from_chars(size_start, record.data() + size_end, file.size);
+			if (result.ec != std::errc{} || result.ptr != record.data() + size_end)
+			{
+				return {};
+			}
+
+			file.hash = std::string(record.substr(2, hash_end - 2));
+			file.name = std::string(record.substr(size_end + 1));
+			return file;
+		}
+	}
+
+	update_journal::update_journal(const std::filesystem::path& folder)
+		: journal_file_(folder / "update-journal.log")
+		, staging_folder_(folder / "staging")
+	{
+	}
+
+	void update_journal::recover(const target_resolver& get_target, const commit_callback& on_committed)
+	{
+		std::string data{};
+		if (!utils::io::read_file(this->journal_file_, &data))
+		{
+			return;
+		}
+
+		const auto committing = this->state_.access<bool>([&data, this](journal_state& state)
+		{
+			state = {};
+
+			// A torn last line was never completely written, so it is not part of the journal
+			size_t start = 0;
+			for (auto end = data.find('\n'); end != std::string::npos; start = end + 1, end = data.find('\n', start))
+			{
+				const std::string_view record(data.data() + start, end - start);
+
+				if (record.size() == 1 && record[0] == JOURNAL_COMMIT_RECORD)
+				{
+					state.committing = true;
+					continue;
+				}
+
+				auto file = parse_staged_record(record);
+				if (file && !file->name.empty() && (state.committing || utils::io::file_exists(this->get_staging_file(file->name).wstring())))
+				{
+					auto name = file->name;
+					state.staged_files[std::move(name)] = std::move(*file);
+				}
+			}
+
+			return state.committing;
+		});
+
+		if (committing)
+		{
+			utils::logger::write("Rolling forward an interrupted update");
+			this->commit(get_target, on_committed);
+			return;
+		}
+
+		const auto staged_count = this->state_.access<size_t>([this](const journal_state& state)
+		{
+			// Staged files that vanished meanwhile don't need to be remembered anymore
+			this->rewrite(state);
+			return state.staged_files.size();
+		});
+
+		if (staged_count > 0)
+		{
+			utils::logger::write("Found {} staged files of an interrupted update", staged_count);
+		}
+	}
+
+	std::filesystem::path update_journal::get_staging_file(const std::string& name) const
+	{
+		return this->staging_folder_ / name;
+	}
+
+	bool update_journal::is_staged(const file_info& file) const
+	{
+		const auto staged = this->state_.access<bool>([&file](const journal_state& state)
+		{
+			const auto entry = state.staged_files.find(file.name);
+			return entry != state.staged_files.end() && entry->second.hash == file.hash && entry->second.size == file.size;
+		});
+
+		return staged && utils::io::file_exists(this->get_staging_file(file.name).wstring());
+	}
+
+	void update_journal::stage(const file_info& file)
+	{
+		this->state_.access([&file, this](journal_state& state)
+		{
+			auto& staged = state.staged_files[file.name];
+			if (staged.hash != file.hash || staged.size != file.size)
+			{
+				staged = file_info{file.name, file.size, file.hash};
+				this->append(get_staged_record(staged));
+			}
+		});
+	}
+
+	void update_journal::commit(const target_resolver& get_target, const commit_callback& on_committed)
+	{
+		this->state_.access([&](journal_state& state)
+		{
+			if (state.staged_files.empty())
+			{
+				this->clear(state);
+				return;
+			}
+
+			if (!state.committing)
+			{
+				this->append(std::string(1, JOURNAL_COMMIT_RECORD) + "\n");
+				state.committing = true;
+			}
+
+			size_t moved_count = 0;
+
+			for (const auto& [name, file] : state.staged_files)
+			{
+				// A staged file that is gone was already moved before the commit got interrupted
+				const auto source = this->get_staging_file(name);
+				if (!utils::io::file_exists(source.wstring()))
+				{
+					continue;
+				}
+
+				const auto target = get_target(name);
+				if (target.has_parent_path())
+				{
+					std::error_code code{};
+					std::filesystem::create_directories(target.parent_path(), code);
+				}
+
+				// The journal stays in the committing state, so the next launch continues from here
+				if (!utils::io::move_file(source, target, true))
+				{
+					throw std::runtime_error("Failed to move staged file into place: " + target.string());
+				}
+
+				++moved_count;
+
+				if (on_committed)
+				{
+					on_committed(file, target);
+				}
+			}
+
+			utils::logger::write("Committed {} staged files", moved_count);
+			this->clear(state);
+		});
+	}
+
+	void update_journal::retain(const std::vector<file_info>& files)
+	{
+		this->state_.access([&](journal_state& state)
+		{
+			if (state.committing || state.staged_files.empty())
+			{
+				return;
+			}
+
+			std::unordered_map<std::string, const file_info*> manifest_files{};
+			manifest_files.reserve(files.size());
+
+			for (const auto& file : files)
+			{
+				manifest_files.emplace(file.name, &file);
+			}
+
+			const auto removed = std::erase_if(state.staged_files, [&](const auto& entry)
+			{
+				const auto file = manifest_files.find(entry.first);
+				if (file != manifest_files.end() && file->second->hash == entry.second.hash && file->second->size == entry.second.size)
+				{
+					return false;
+				}
+
+				utils::io::remove_file(this->get_staging_file(entry.first));
+				return true;
+			});
+
+			if (removed > 0)
+			{
+				this->rewrite(state);
+			}
+		});
+	}
+
+	void update_journal::append(const std::string& record) const
+	{
+		std::error_code code{};
+		std::filesystem::create_directories(this->journal_file_.parent_path(), code);
+
+		auto* const handle = CreateFileW(this->journal_file_.wstring().data(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+		                                 OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Failed to open update journal: " + this->journal_file_.string());
+		}
+
+		const auto _ = gsl::finally([handle]()
+		{
+			CloseHandle(handle);
+		});
+
+		// A record only counts once it reached the disk, everything it refers to was flushed before
+		DWORD written = 0;
+		if (!WriteFile(handle, record.data(), static_cast<DWORD>(record.size()), &written, nullptr)
+			|| written != record.size() || !FlushFileBuffers(handle))
+		{
+			throw std::runtime_error("Failed to write update journal: " + this->journal_file_.string());
+		}
+	}
+
+	void update_journal::rewrite(const journal_state& state) const
+	{
+		if (state.staged_files.empty())
+		{
+			utils::io::remove_file(this->journal_file_);
+			return;
+		}
+
+		std::string data{};
+		for (const auto& entry : state.staged_files)
+		{
+			data += get_staged_record(entry.second);
+		}
+
+		// The compacted journal replaces the old one in a single step
+		auto temp_file = this->journal_file_;
+		temp_file += ".tmp";
+
+		if (!utils::io::write_file(temp_file, data) || !utils::io::move_file(temp_file, this->journal_file_, true))
+		{
+			utils::io::remove_file(temp_file);
+			utils::logger::write("Failed to write update journal {}", this->journal_file_.string());
+		}
+	}
+
+	void update_journal::clear(journal_state& state) const
+	{
+		// The staging folder goes first, a journal without it only leads to another commit that finds nothing to move
+		std::error_code code{};
+		std::filesystem::remove_all(this->staging_folder_, code);
+
+		utils::io::remove_file(this->journal_file_);
+
+		state = {};
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "file_info.hpp"
+
+#include <utils/io.hpp>
+#include <utils/concurrency.hpp>
+
+namespace updater
+{
+	// Updated files are staged in a folder of their own and only moved into place once all of them are complete.
+	// The journal records every staged file and then the start of the commit, from which on an interrupted update is
+	// rolled forward on the next launch, so the data folder holds either the old or the new set of files, never a mix.
+	// Files staged by an update that didn't reach the commit are kept and reused by the next one.
+	class update_journal
+	{
+	public:
+		using target_resolver = std::function<std::filesystem::path(const std::string& name)>;
+		using commit_callback = std::function<void(const file_info& file, const std::filesystem::path& target)>;
+
+		update_journal(const std::filesystem::path& folder);
+
+		// Finishes a commit that was interrupted and picks up the files staged by an update that was
+		void recover(const target_resolver& get_target, const commit_callback& on_committed);
+
+		[[nodiscard]] std::filesystem::path get_staging_file(const std::string& name) const;
+		[[nodiscard]] bool is_staged(const file_info& file) const;
+
+		// Records a file once it is complete and durable in the staging folder
+		void stage(const file_info& file);
+
+		// Moves all staged files into place, the callback runs for every file that was moved
+		void commit(const target_resolver& get_target, const commit_callback& on_committed);
+
+		// Drops staged files the manifest doesn't contain in that version anymore
+		void retain(const std::vector<file_info>& files);
+
+	private:
+		struct journal_state
+		{
+			std::unordered_map<std::string, file_info> staged_files{};
+			bool committing{};
+		};
+
+		std::filesystem::path journal_file_;
+		std::filesystem::path staging_folder_;
+		utils::concurrency::container<journal_state> state_{};
+
+		void append(const std::string& record) const;
+		void rewrite(const journal_state& state) const;
+		void clear(journal_state& state) const;
+	};
+}
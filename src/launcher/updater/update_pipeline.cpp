@@ -0,0 +1,311 @@
+#include <std_include.hpp>
+
+#include "update_pipeline.hpp"
+
+#include <utils/logger.hpp>
+
+// Enough to keep every worker busy, while a slow stage still holds back the one before it
+#define UPDATE_PIPELINE_QUEUE_SIZE 64
+
+// Idle workers look for running downloads to join this often while files can still arrive
+#define UPDATE_PIPELINE_IDLE_INTERVAL std::chrono::milliseconds(100)
+
+namespace updater
+{
+	namespace
+	{
+		bool is_smaller(const file_info& a, const file_info& b)
+		{
+			return a.size < b.size;
+		}
+	}
+
+	update_pipeline::update_pipeline(const size_t worker_count, stages pipeline_stages)
+		: stages_(std::move(pipeline_stages))
+		, start_(std::chrono::steady_clock::now())
+	{
+		const auto count = std::max<size_t>(worker_count, 1);
+
+		this->state_.access([count](pipeline_state& state)
+		{
+			state.running_workers = count;
+		});
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			this->workers_.emplace_back([this]()
+			{
+				this->work();
+			});
+		}
+
+		this->committer_ = std::thread([this]()
+		{
+			this->commit();
+		});
+	}
+
+	update_pipeline::~update_pipeline()
+	{
+		// Anything still running is abandoned, as if it had failed
+		if (this->committer_.joinable())
+		{
+			this->state_.access([](pipeline_state& state)
+			{
+				state.closed = true;
+				state.downloads.clear();
+			});
+
+			this->fail({});
+			this->join();
+		}
+	}
+
+	void update_pipeline::push(file_info file)
+	{
+		this->state_.access_with_lock([&](pipeline_state& state, std::unique_lock<std::mutex>& lock)
+		{
+			this->download_space_event_.wait(lock, [&state]()
+			{
+				return state.downloads.size() < UPDATE_PIPELINE_QUEUE_SIZE || state.closed || state.exception;
+			});
+
+			if (state.closed || state.exception)
+			{
+				return;
+			}
+
+			state.downloads.emplace_back(std::move(file));
+			std::ranges::push_heap(state.downloads, is_smaller);
+			++state.file_count;
+		});
+
+		this->download_event_.notify_one();
+	}
+
+	void update_pipeline::close()
+	{
+		this->state_.access([](pipeline_state& state)
+		{
+			state.closed = true;
+		});
+
+		this->download_event_.notify_all();
+		this->download_space_event_.notify_all();
+	}
+
+	void update_pipeline::cancel()
+	{
+		this->state_.access([](pipeline_state& state)
+		{
+			state.closed = true;
+			state.downloads.clear();
+		});
+
+		this->download_event_.notify_all();
+		this->download_space_event_.notify_all();
+	}
+
+	void update_pipeline::finish()
+	{
+		this->close();
+		this->join();
+
+		const auto end = std::chrono::steady_clock::now();
+		const auto to_milliseconds = [](const std::chrono::steady_clock::duration duration)
+		{
+			return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+		};
+
+		const auto state = this->state_.access<pipeline_state>([](pipeline_state& current)
+		{
+			return std::move(current);
+		});
+
+		if (state.exception)
+		{
+			std::rethrow_exception(state.exception);
+		}
+
+		// The tail is the time from the first worker running out of work until the last file was done
+		utils::logger::write("Updated {} files with {} workers in {}ms, the first one started after {}ms, {}ms with idle workers",
+		                     state.file_count, this->workers_.size(), to_milliseconds(end - this->start_),
+		                     to_milliseconds(state.first_download.value_or(end) - this->start_),
+		                     to_milliseconds(end - state.first_idle.value_or(end)));
+	}
+
+	void update_pipeline::work()
+	{
+		try
+		{
+			while (const auto file = this->next_download())
+			{
+				this->stages_.download(*file);
+
+				this->state_.access_with_lock([&](pipeline_state& state, std::unique_lock<std::mutex>& lock)
+				{
+					this->commit_space_event_.wait(lock, [&state]()
+					{
+						return state.commits.size() < UPDATE_PIPELINE_QUEUE_SIZE || state.exception;
+					});
+
+					state.commits.emplace_back(*file);
+				});
+
+				this->commit_event_.notify_one();
+			}
+
+			// Nothing left to start, but large files might still be downloading and can use another connection
+			while (!this->has_failed() && this->stages_.help())
+			{
+			}
+		}
+		catch (...)
+		{
+			this->fail(std::current_exception());
+		}
+
+		this->state_.access([](pipeline_state& state)
+		{
+			--state.running_workers;
+
+			if (!state.first_idle)
+			{
+				state.first_idle = std::chrono::steady_clock::now();
+			}
+		});
+
+		this->commit_event_.notify_one();
+	}
+
+	std::optional<file_info> update_pipeline::next_download()
+	{
+		while (true)
+		{
+			auto done = false;
+
+			auto file = this->state_.access_with_lock<std::optional<file_info>>(
+				[&](pipeline_state& state, std::unique_lock<std::mutex>& lock) -> std::optional<file_info>
+				{
+					this->download_event_.wait_for(lock, UPDATE_PIPELINE_IDLE_INTERVAL, [&state]()
+					{
+						return !state.downloads.empty() || state.closed || state.exception;
+					});
+
+					if (state.exception || state.downloads.empty())
+					{
+						done = state.exception || state.closed;
+						return {};
+					}
+
+					std::ranges::pop_heap(state.downloads, is_smaller);
+					auto next = std::move(state.downloads.back());
+					state.downloads.pop_back();
+
+					if (!state.first_download)
+					{
+						state.first_download = std::chrono::steady_clock::now();
+					}
+
+					return {std::move(next)};
+				});
+
+			if (file)
+			{
+				this->download_space_event_.notify_one();
+				return file;
+			}
+
+			if (done)
+			{
+				return {};
+			}
+
+			// The scan is still running, so a download that is already going gets the spare connection meanwhile
+			while (this->stages_.help())
+			{
+			}
+		}
+	}
+
+	void update_pipeline::commit()
+	{
+		while (true)
+		{
+			const auto file = this->state_.access_with_lock<std::optional<file_info>>(
+				[this](pipeline_state& state, std::unique_lock<std::mutex>& lock) -> std::optional<file_info>
+				{
+					this->commit_event_.wait(lock, [&state]()
+					{
+						return !state.commits.empty() || state.running_workers == 0 || state.exception;
+					});
+
+					if (state.exception || state.commits.empty())
+					{
+						return {};
+					}
+
+					auto next = std::move(state.commits.front());
+					state.commits.pop_front();
+					return {std::move(next)};
+				});
+
+			if (!file)
+			{
+				return;
+			}
+
+			this->commit_space_event_.notify_one();
+
+			try
+			{
+				this->stages_.commit(*file);
+			}
+			catch (...)
+			{
+				this->fail(std::current_exception());
+				return;
+			}
+		}
+	}
+
+	void update_pipeline::fail(std::exception_ptr exception)
+	{
+		this->state_.access([&exception](pipeline_state& state)
+		{
+			if (!state.exception)
+			{
+				state.exception = exception ? std::move(exception) : std::make_exception_ptr(std::runtime_error("Update was abandoned"));
+			}
+		});
+
+		this->download_event_.notify_all();
+		this->commit_event_.notify_all();
+		this->download_space_event_.notify_all();
+		this->commit_space_event_.notify_all();
+	}
+
+	bool update_pipeline::has_failed() const
+	{
+		return this->state_.access<bool>([](const pipeline_state& state)
+		{
+			return static_cast<bool>(state.exception);
+		});
+	}
+
+	void update_pipeline::join()
+	{
+		for (auto& worker : this->workers_)
+		{
+			if (worker.joinable())
+			{
+				worker.join();
+			}
+		}
+
+		if (this->committer_.joinable())
+		{
+			this->committer_.join();
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "file_info.hpp"
+
+#include <utils/concurrency.hpp>
+
+namespace updater
+{
+	// Runs an update as overlapping stages: files can be queued while the scan is still running, are downloaded and
+	// verified by a set of workers and are then committed one at a time on a thread of their own.
+	// The queues between the stages are bounded, so a slow stage holds back the one before it.
+	class update_pipeline
+	{
+	public:
+		struct stages
+		{
+			// Downloads and verifies a file, runs on the workers
+			std::function<void(const file_info&)> download{};
+
+			// Lets a worker without a file of its own join a running download, returns false if there was none
+			std::function<bool()> help{};
+
+			// Records a finished file, runs on the commit thread in the order the downloads finished
+			std::function<void(const file_info&)> commit{};
+		};
+
+		update_pipeline(size_t worker_count, stages pipeline_stages);
+		~update_pipeline();
+
+		update_pipeline(update_pipeline&&) = delete;
+		update_pipeline(const update_pipeline&) = delete;
+		update_pipeline& operator=(update_pipeline&&) = delete;
+		update_pipeline& operator=(const update_pipeline&) = delete;
+
+		// Blocks while the download queue is full, the largest of the queued files is started first
+		void push(file_info file);
+
+		// No more files will follow, the workers stop once the queue is empty
+		void close();
+
+		// Drops the queued files, files already in progress are still finished
+		void cancel();
+
+		// Waits for all stages and rethrows the first error any of them ran into
+		void finish();
+
+	private:
+		using time_point = std::chrono::steady_clock::time_point;
+
+		struct pipeline_state
+		{
+			std::vector<file_info> downloads{};
+			std::deque<file_info> commits{};
+			size_t running_workers{};
+			size_t file_count{};
+			bool closed{};
+			std::exception_ptr exception{};
+			std::optional<time_point> first_download{};
+			std::optional<time_point> first_idle{};
+		};
+
+		stages stages_;
+		time_point start_{};
+
+		utils::concurrency::container<pipeline_state> state_{};
+		std::condition_variable download_event_{};
+		std::condition_variable commit_event_{};
+		std::condition_variable download_space_event_{};
+		std::condition_variable commit_space_event_{};
+
+		std::vector<std::thread> workers_{};
+		std::thread committer_{};
+
+		void work();
+		void commit();
+		void fail(std::exception_ptr exception);
+		void join();
+
+		[[nodiscard]] bool has_failed() const;
+		[[nodiscard]] std::optional<file_info> next_download();
+	};
+}
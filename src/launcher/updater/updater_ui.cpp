@@ -23,6 +23,15 @@ namespace updater
 		this->progress_ui_.show();
 	}
 
+	void updater_ui::add_file(const file_info& file)
+	{
+		std::lock_guard<std::recursive_mutex> _{this->mutex_};
+
+		this->total_files_.emplace_back(file);
+		this->update_progress();
+		this->update_file_name();
+	}
+
 	void updater_ui::done_update()
 	{
 		std::lock_guard<std::recursive_mutex> _{this->mutex_};
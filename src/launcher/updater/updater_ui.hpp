@@ -22,6 +22,7 @@ namespace updater
 		progress_ui progress_ui_{};
 
 		void update_files(const std::vector<file_info>& files) override;
+		void add_file(const file_info& file) override;
 		void done_update() override;
 
 		void begin_file(const file_info& file) override;
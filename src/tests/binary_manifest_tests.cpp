@@ -0,0 +1,239 @@
+#include "test.hpp"
+
+#include <std_include.hpp>
+
+#include <updater/binary_manifest.hpp>
+
+#include <cstring>
+
+namespace
+{
+	// Header field offsets of the binary manifest format
+	constexpr size_t record_count_offset = 16;
+	constexpr size_t patch_count_offset = 20;
+	constexpr size_t records_offset_offset = 24;
+	constexpr size_t patches_offset_offset = 28;
+	constexpr size_t index_offset_offset = 32;
+	constexpr size_t strings_offset_offset = 36;
+	constexpr size_t strings_size_offset = 40;
+
+	// Record layout, each string reference is an offset and a length into the pool
+	constexpr size_t record_size = 56;
+	constexpr size_t record_hash_offset = 8;
+	constexpr size_t record_first_patch_offset = 48;
+	constexpr size_t record_patch_count_offset = 52;
+
+	std::uint32_t read_field(const std::string& data, const size_t offset)
+	{
+		std::uint32_t value{};
+		std::memcpy(&value, data.data() + offset, sizeof(value));
+		return value;
+	}
+
+	void write_field(std::string& data, const size_t offset, const std::uint32_t value)
+	{
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	std::vector<updater::file_info> get_files()
+	{
+		std::vector<updater::file_info> files{};
+
+		updater::file_info launcher{};
+		launcher.name = "xlabs.exe";
+		launcher.size = 1234;
+		launcher.hash = "aaaa";
+		files.emplace_back(std::move(launcher));
+
+		updater::file_info data{};
+		data.name = "data/ui_scripts/main.lua";
+		data.size = 56;
+		data.hash = "bbbb";
+		data.tree_hash = "cccc";
+		data.codec = "gzip";
+		data.compressed_size = 30;
+		data.patches.push_back({"dddd", 12, "eeee"});
+		data.patches.push_back({"ffff", 14, "gggg"});
+		files.emplace_back(std::move(data));
+
+		updater::file_info archive{};
+		archive.name = "data/archive.ff";
+		archive.size = 78;
+		archive.hash = "hhhh";
+		files.emplace_back(std::move(archive));
+
+		return files;
+	}
+
+	std::string get_manifest_data()
+	{
+		return updater::binary_manifest::build(get_files(), 4321);
+	}
+
+	bool is_valid(std::string data)
+	{
+		const updater::binary_manifest manifest{std::move(data)};
+		return static_cast<bool>(manifest);
+	}
+}
+
+TEST_CASE(binary_manifest_round_trips_entries)
+{
+	const auto files = get_files();
+	const updater::binary_manifest manifest{get_manifest_data()};
+
+	CHECK(manifest);
+	CHECK(manifest.size() == files.size());
+	CHECK(manifest.get_source_size() == 4321);
+
+	for (const auto& file : files)
+	{
+		const auto index = manifest.find(file.name);
+		CHECK(index.has_value());
+		if (!index)
+		{
+			continue;
+		}
+
+		const auto info = manifest.get_file_info(*index);
+		CHECK(info.name == file.name && info.size == file.size && info.hash == file.hash);
+		CHECK(info.tree_hash == file.tree_hash && info.codec == file.codec && info.compressed_size == file.compressed_size);
+		CHECK(info.patches.size() == file.patches.size());
+
+		for (size_t i = 0; i < info.patches.size() && i < file.patches.size(); ++i)
+		{
+			CHECK(info.patches[i].from_hash == file.patches[i].from_hash);
+			CHECK(info.patches[i].hash == file.patches[i].hash && info.patches[i].size == file.patches[i].size);
+		}
+	}
+}
+
+TEST_CASE(binary_manifest_looks_up_names_and_prefixes)
+{
+	const updater::binary_manifest manifest{get_manifest_data()};
+
+	CHECK(!manifest.find("data").has_value());
+	CHECK(!manifest.find("xlabs.ex").has_value());
+	CHECK(!manifest.find("zzz").has_value());
+
+	CHECK(manifest.has_prefix("data/"));
+	CHECK(manifest.has_prefix("data/ui_scripts/"));
+	CHECK(!manifest.has_prefix("data/ui_scripts/other"));
+	CHECK(!manifest.has_prefix("zzz"));
+}
+
+TEST_CASE(binary_manifest_handles_empty_manifests)
+{
+	const updater::binary_manifest manifest{updater::binary_manifest::build({}, 0)};
+
+	CHECK(manifest);
+	CHECK(manifest.size() == 0);
+	CHECK(!manifest.find("xlabs.exe").has_value());
+	CHECK(!manifest.has_prefix(""));
+}
+
+TEST_CASE(binary_manifest_rejects_bad_headers)
+{
+	const auto data = get_manifest_data();
+
+	CHECK(!is_valid({}));
+	CHECK(!is_valid(data.substr(0, 47)));
+
+	auto magic = data;
+	magic[0] = 'Y';
+	CHECK(!is_valid(magic));
+
+	auto version = data;
+	write_field(version, 4, 2);
+	CHECK(!is_valid(version));
+}
+
+TEST_CASE(binary_manifest_rejects_truncated_data)
+{
+	const auto data = get_manifest_data();
+	CHECK(is_valid(data));
+
+	// The string pool is last, dropping any of it cuts off the last string
+	for (size_t length = 0; length < data.size(); ++length)
+	{
+		CHECK(!is_valid(data.substr(0, length)));
+	}
+}
+
+TEST_CASE(binary_manifest_rejects_tables_out_of_range)
+{
+	const auto data = get_manifest_data();
+
+	for (const auto field : {records_offset_offset, patches_offset_offset, index_offset_offset, strings_offset_offset})
+	{
+		// Past the end, and misaligned
+		auto outside = data;
+		write_field(outside, field, static_cast<std::uint32_t>(data.size() + 8));
+		CHECK(!is_valid(outside));
+
+		auto misaligned = data;
+		write_field(misaligned, field, read_field(data, field) + 4);
+		CHECK(!is_valid(misaligned));
+
+		auto wrapped = data;
+		write_field(wrapped, field, 0xFFFFFFF8);
+		CHECK(!is_valid(wrapped));
+	}
+
+	for (const auto field : {record_count_offset, patch_count_offset, strings_size_offset})
+	{
+		auto oversized = data;
+		write_field(oversized, field, 0xFFFFFFFF);
+		CHECK(!is_valid(oversized));
+	}
+}
+
+TEST_CASE(binary_manifest_rejects_strings_out_of_range)
+{
+	const auto data = get_manifest_data();
+	const auto records = read_field(data, records_offset_offset);
+	const auto patches = read_field(data, patches_offset_offset);
+	const auto strings_size = read_field(data, strings_size_offset);
+
+	// Record string past the pool, and an offset and length that wrap around
+	auto name = data;
+	write_field(name, records + 4, strings_size + 1);
+	CHECK(!is_valid(name));
+
+	auto hash = data;
+	write_field(hash, records + record_hash_offset, 1);
+	write_field(hash, records + record_hash_offset + 4, 0xFFFFFFFF);
+	CHECK(!is_valid(hash));
+
+	// Patch string past the pool
+	auto patch = data;
+	write_field(patch, patches, strings_size);
+	write_field(patch, patches + 4, 1);
+	CHECK(!is_valid(patch));
+}
+
+TEST_CASE(binary_manifest_rejects_indices_out_of_range)
+{
+	const auto data = get_manifest_data();
+	const auto records = read_field(data, records_offset_offset);
+	const auto index = read_field(data, index_offset_offset);
+
+	auto name_index = data;
+	write_field(name_index, index + 4, 3);
+	CHECK(!is_valid(name_index));
+
+	// The second record has two patches, they may not reach past the table or wrap around
+	const auto second_record = records + record_size;
+
+	auto first_patch = data;
+	write_field(first_patch, second_record + record_first_patch_offset, 1);
+	CHECK(!is_valid(first_patch));
+
+	auto patch_count = data;
+	write_field(patch_count, second_record + record_patch_count_offset, 3);
+	CHECK(!is_valid(patch_count));
+
+	auto wrapped = data;
+	write_field(wrapped, second_record + record_first_patch_offset, 0xFFFFFFFF);
+	CHECK(!is_valid(wrapped));
+}
@@ -0,0 +1,131 @@
+#include "test.hpp"
+
+#include <utils/chunking.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::string get_random_data(const size_t size, uint32_t seed)
+	{
+		std::string data(size, 0);
+		for (auto& value : data)
+		{
+			seed = seed * 1664525 + 1013904223;
+			value = static_cast<char>(seed >> 24);
+		}
+
+		return data;
+	}
+
+	std::vector<std::string_view> split(const std::string_view data, const utils::chunking::parameters& params)
+	{
+		std::vector<std::string_view> chunks{};
+		utils::chunking::split(data, params, [&chunks](const std::string_view chunk)
+		{
+			chunks.push_back(chunk);
+		});
+
+		return chunks;
+	}
+
+	bool covers(const std::vector<std::string_view>& chunks, const std::string_view data)
+	{
+		std::string joined{};
+		for (const auto& chunk : chunks)
+		{
+			joined.append(chunk);
+		}
+
+		return joined == data;
+	}
+}
+
+TEST_CASE(chunking_keeps_chunks_within_limits)
+{
+	const auto data = get_random_data(4 * 1024 * 1024, 1);
+	const utils::chunking::parameters params{};
+
+	const auto chunks = split(data, params);
+	CHECK(chunks.size() > 1);
+	CHECK(covers(chunks, data));
+
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		CHECK(chunks[i].size() <= params.max_size);
+		CHECK(i + 1 == chunks.size() || chunks[i].size() > params.min_size);
+	}
+}
+
+TEST_CASE(chunking_cuts_at_max_size_without_boundaries)
+{
+	// A run of zeros has no boundary with these parameters, so chunks are cut at the maximum
+	const std::string data(1000, 0);
+	const auto chunks = split(data, {10, 256, 300});
+
+	CHECK(chunks.size() == 4);
+	CHECK(chunks[0].size() == 300 && chunks[3].size() == 100);
+	CHECK(covers(chunks, data));
+}
+
+TEST_CASE(chunking_handles_short_and_empty_data)
+{
+	CHECK(split({}, {}).empty());
+
+	const auto data = get_random_data(100, 2);
+	const auto chunks = split(data, {});
+	CHECK(chunks.size() == 1 && chunks[0] == data);
+}
+
+TEST_CASE(chunking_supports_fixed_size_chunks)
+{
+	const auto data = get_random_data(1000, 3);
+	const auto chunks = split(data, {64, 64, 64});
+
+	CHECK(chunks.size() == 16);
+	CHECK(chunks[15].size() == 1000 - 15 * 64);
+	CHECK(covers(chunks, data));
+}
+
+TEST_CASE(chunking_rejects_zero_length_chunks)
+{
+	CHECK_THROWS(split("abc", {0, 0, 0}));
+}
+
+TEST_CASE(chunking_resynchronizes_after_insertions)
+{
+	const auto data = get_random_data(2 * 1024 * 1024, 4);
+	const auto edited = "inserted" + data;
+
+	const utils::chunking::parameters params{4 * 1024, 16 * 1024, 64 * 1024};
+	const auto original_chunks = split(data, params);
+	const auto edited_chunks = split(edited, params);
+
+	// All but the first few chunks are shared
+	size_t shared = 0;
+	for (auto a = original_chunks.rbegin(), b = edited_chunks.rbegin();
+	     a != original_chunks.rend() && b != edited_chunks.rend() && *a == *b; ++a, ++b)
+	{
+		++shared;
+	}
+
+	CHECK(shared + 2 >= original_chunks.size());
+}
+
+TEST_CASE(chunking_boundaries_are_stable)
+{
+	// The publishing side computes the same boundaries, the gear table must not change
+	const auto data = get_random_data(1024 * 1024, 5);
+
+	std::vector<size_t> sizes{};
+	for (const auto& chunk : split(data, {}))
+	{
+		sizes.push_back(chunk.size());
+	}
+
+	CHECK((sizes == std::vector<size_t>{
+		26866, 25225, 143763, 98659, 22125, 100707, 38262, 208820, 73582, 70755, 162893, 76919,
+	}));
+}
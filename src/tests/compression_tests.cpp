@@ -0,0 +1,307 @@
+#include "test.hpp"
+
+#include <utils/compression.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+namespace
+{
+	namespace vectors
+	{
+		// Made with zlib from the text of the generators below.
+		// Fixed codes, forced with Z_FIXED
+		constexpr unsigned char fixed_stream[] = {
+			0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x73, 0xCD, 0x2B, 0x29, 0xAA, 0x54,
+			0x30, 0x50, 0xC8, 0x4F, 0x53, 0x28, 0xC9, 0x48, 0x55, 0xC8, 0x4D, 0xCC, 0xCB, 0x4C, 0x4B, 0x2D,
+			0x2E, 0x51, 0x28, 0xC8, 0xCF, 0xCC, 0x2B, 0x29, 0x56, 0x48, 0x2C, 0x51, 0x48, 0x49, 0x2C, 0x49,
+			0xD4, 0x4F, 0xCB, 0xCC, 0x49, 0x8D, 0x37, 0xD0, 0x4B, 0xCA, 0xCC, 0xE3, 0x72, 0x05, 0xEB, 0x30,
+			0x24, 0x4A, 0x87, 0x39, 0x92, 0x0E, 0x23, 0xA2, 0x74, 0x18, 0x22, 0xE9, 0x30, 0x26, 0x4A, 0x87,
+			0x05, 0x92, 0x0E, 0x13, 0xA2, 0x74, 0x18, 0x21, 0xE9, 0x30, 0x25, 0x4A, 0x87, 0x25, 0x92, 0x0E,
+			0x33, 0xA2, 0x74, 0x18, 0x23, 0xE9, 0x30, 0x27, 0xCE, 0xE7, 0xC8, 0xC1, 0x6B, 0x41, 0x94, 0x16,
+			0x13, 0x24, 0x1D, 0x96, 0xC4, 0x59, 0x82, 0x1C, 0xBE, 0x86, 0xC4, 0x45, 0xBB, 0x29, 0xB2, 0x16,
+			0xE2, 0xE2, 0xDD, 0x10, 0x39, 0x88, 0x0D, 0x89, 0x8B, 0x79, 0x33, 0x64, 0x2D, 0xC6, 0xA4, 0x27,
+			0x48, 0x13, 0x92, 0x53, 0xA4, 0xA1, 0x29, 0xC9, 0x49, 0xD2, 0xD0, 0x8C, 0xE4, 0x34, 0x69, 0x68,
+			0x4E, 0x72, 0xA2, 0x34, 0xB4, 0x20, 0x39, 0x55, 0x1A, 0x5A, 0x92, 0x9C, 0x2C, 0x8D, 0x0C, 0x48,
+			0x4F, 0x97, 0x46, 0x86, 0x24, 0x27, 0x4C, 0x23, 0x23, 0xD2, 0x53, 0xA6, 0x91, 0x31, 0xC9, 0x29,
+			0xD3, 0xC8, 0x84, 0xF4, 0x94, 0x69, 0x64, 0x4A, 0x72, 0xCA, 0x34, 0x32, 0x23, 0x39, 0x65, 0x1A,
+			0x99, 0x93, 0x5E, 0x56, 0x5A, 0x90, 0x9C, 0x32, 0x8D, 0x2C, 0x49, 0x4E, 0x99, 0xC6, 0x06, 0x24,
+			0xA7, 0x4C, 0x63, 0x43, 0x92, 0x53, 0xA6, 0xB1, 0x11, 0xC9, 0x29, 0xD3, 0xD8, 0x98, 0xF4, 0x94,
+			0x69, 0x6C, 0x42, 0x72, 0xCA, 0x34, 0x36, 0x25, 0x3D, 0x65, 0x1A, 0x9B, 0x91, 0x9C, 0x32, 0x8D,
+			0xCD, 0x49, 0x4F, 0x99, 0xC6, 0x16, 0x24, 0xA7, 0x4C, 0x63, 0x4B, 0x12, 0x52, 0x26, 0x00, 0xBD,
+			0x14, 0xFB, 0xB0, 0xF7, 0x07, 0x00, 0x00,
+		};
+
+		// Dynamic codes with matches, default strategy
+		constexpr unsigned char dynamic_stream[] = {
+			0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0xD4, 0xCD, 0x0D, 0xC2, 0x30,
+			0x0C, 0x86, 0xE1, 0x3B, 0x53, 0x64, 0x02, 0x88, 0xED, 0xFC, 0x0E, 0xD0, 0x39, 0x50, 0x10, 0xAD,
+			0x88, 0x04, 0x29, 0xA2, 0xB9, 0xB0, 0x3D, 0x12, 0x27, 0x1F, 0xFD, 0x0D, 0xF0, 0xCA, 0x8A, 0xFD,
+			0x28, 0xCB, 0x98, 0x9F, 0xAF, 0xF3, 0x6E, 0xDF, 0xDC, 0x7C, 0xAC, 0xEE, 0xD5, 0x46, 0xDF, 0xD6,
+			0x63, 0xBA, 0xF7, 0xDE, 0xC7, 0x3C, 0x5C, 0x9B, 0xEE, 0xDE, 0x66, 0xBB, 0x6C, 0xFD, 0xB9, 0x5E,
+			0xFD, 0xF9, 0xD6, 0xC7, 0x69, 0xF9, 0x17, 0x64, 0x2A, 0xB2, 0x2A, 0xD8, 0x54, 0x90, 0x2A, 0xC4,
+			0x54, 0x14, 0x55, 0x04, 0x53, 0xC1, 0xAA, 0x88, 0xA6, 0xA2, 0xAA, 0x22, 0x99, 0x0A, 0x51, 0x45,
+			0xB6, 0xBD, 0x5C, 0xAF, 0xB7, 0x98, 0x92, 0xA0, 0x8A, 0x6A, 0x1B, 0xA2, 0xF7, 0x4B, 0xB6, 0xB3,
+			0x47, 0x9D, 0xD8, 0xEE, 0x4E, 0x7A, 0xC5, 0x64, 0xBB, 0x7C, 0xD2, 0x89, 0xE0, 0x20, 0x03, 0x2C,
+			0x92, 0x22, 0x4C, 0x92, 0x12, 0x6C, 0x92, 0x32, 0x8C, 0x92, 0x0A, 0xAC, 0x92, 0x2A, 0xCC, 0x92,
+			0x3D, 0xEE, 0x92, 0x09, 0x86, 0xC9, 0x8C, 0xCB, 0x64, 0x81, 0x65, 0x72, 0xC0, 0x65, 0x72, 0x84,
+			0x65, 0x72, 0x82, 0x65, 0x72, 0xC6, 0xFF, 0xCA, 0x02, 0xCB, 0xE4, 0x0A, 0xCB, 0x14, 0x0F, 0xCB,
+			0x14, 0x82, 0x65, 0x0A, 0xC3, 0x32, 0x45, 0x70, 0x99, 0x12, 0x60, 0x99, 0x12, 0x71, 0x99, 0x92,
+			0x60, 0x99, 0x92, 0x71, 0x99, 0x52, 0x60, 0x99, 0x52, 0x01, 0x99, 0x3F, 0xBD, 0x14, 0xFB, 0xB0,
+			0xF7, 0x07, 0x00, 0x00,
+		};
+
+		// Huffman only, the rarest symbols get 11 bit codes, which are decoded through a subtable
+		constexpr unsigned char long_code_stream[] = {
+			0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x05, 0xC1, 0xC1, 0x81, 0x24, 0xC9,
+			0x11, 0x04, 0x31, 0x59, 0x79, 0x3B, 0x5D, 0x19, 0x6E, 0xD0, 0xFF, 0x4F, 0xE0, 0x7F, 0xFF, 0xFD,
+			0xF7, 0xEF, 0xDF, 0xBF, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0x7F, 0xBF, 0xDF, 0xEF,
+			0xF7, 0xFB, 0xFD, 0x7E, 0xBF, 0xDF, 0xEF, 0xF7, 0xFB, 0xFD, 0x7E, 0xDF, 0xF7, 0x7D, 0xDF, 0xF7,
+			0x7D, 0xDF, 0xF7, 0x7D, 0xDF, 0xF7, 0x7D, 0xDF, 0xF7, 0x7D, 0xDF, 0xF7, 0x7D, 0xDF, 0xF7, 0x7D,
+			0xDF, 0xF7, 0x7D, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0xEF, 0xBD, 0xF7,
+			0xDE, 0x7B, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0xEF, 0xBD, 0xF7, 0xDE,
+			0x7B, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0xEF, 0xBD, 0xF7, 0xDE, 0x7B, 0x77, 0x77, 0x77, 0x77, 0x77,
+			0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+			0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+			0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77,
+			0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6,
+			0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D,
+			0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB,
+			0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6,
+			0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D,
+			0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB,
+			0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0xDB, 0xB6, 0x6D, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55,
+			0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x07, 0xBF, 0x2B, 0xAD,
+			0x9E, 0xFF, 0x07, 0x00, 0x00,
+		};
+	}
+
+	std::string get_manifest_text()
+	{
+		std::string text{};
+		for (auto i = 0; i < 40; ++i)
+		{
+			text += "Entry " + std::to_string(i) + " of the manifest points at data/file_" + std::to_string(i * 7 % 13) + ".bin\n";
+		}
+
+		return text;
+	}
+
+	std::string get_skewed_text()
+	{
+		std::string text{};
+		for (auto i = 0; i < 11; ++i)
+		{
+			text.append(size_t(1) << i, static_cast<char>('a' + i));
+		}
+
+		return text;
+	}
+
+	template <size_t Size>
+	std::string to_string(const unsigned char (&data)[Size])
+	{
+		return {reinterpret_cast<const char*>(data), Size};
+	}
+
+	uint32_t crc32(const std::string& data)
+	{
+		uint32_t crc = ~0u;
+		for (const auto byte : data)
+		{
+			crc ^= static_cast<uint8_t>(byte);
+			for (auto i = 0; i < 8; ++i)
+			{
+				crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+			}
+		}
+
+		return ~crc;
+	}
+
+	void append_uint32(std::string& data, const uint32_t value)
+	{
+		for (auto i = 0; i < 4; ++i)
+		{
+			data.push_back(static_cast<char>(value >> (i * 8)));
+		}
+	}
+
+	// Builds a gzip stream out of stored blocks, which allows inputs of any size without embedding them
+	std::string make_stored_stream(const std::string& data, const size_t block_size)
+	{
+		std::string stream("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+
+		size_t offset = 0;
+		do
+		{
+			const auto length = std::min(block_size, data.size() - offset);
+			const auto last = offset + length == data.size();
+
+			stream.push_back(last ? 1 : 0);
+			stream.push_back(static_cast<char>(length));
+			stream.push_back(static_cast<char>(length >> 8));
+			stream.push_back(static_cast<char>(~length));
+			stream.push_back(static_cast<char>(~length >> 8));
+			stream.append(data, offset, length);
+
+			offset += length;
+		}
+		while (offset < data.size());
+
+		append_uint32(stream, crc32(data));
+		append_uint32(stream, static_cast<uint32_t>(data.size()));
+
+		return stream;
+	}
+
+	std::string get_random_data(const size_t size)
+	{
+		std::string data(size, 0);
+
+		uint32_t state = 12345;
+		for (auto& byte : data)
+		{
+			state = state * 1103515245 + 12345;
+			byte = static_cast<char>(state >> 16);
+		}
+
+		return data;
+	}
+
+	std::string decode(const std::string& stream, const size_t piece_size = SIZE_MAX)
+	{
+		std::string result{};
+		utils::compression::gzip_decoder decoder{[&result](const std::string_view data)
+		{
+			result.append(data);
+		}};
+
+		for (size_t offset = 0; offset < stream.size(); offset += piece_size)
+		{
+			decoder.write(stream.data() + offset, std::min(piece_size, stream.size() - offset));
+		}
+
+		decoder.finish();
+		CHECK(decoder.is_done());
+
+		return result;
+	}
+}
+
+TEST_CASE(gzip_decodes_stored_blocks)
+{
+	const auto data = get_random_data(200 * 1024);
+	CHECK(decode(make_stored_stream(data, 65535)) == data);
+	CHECK(decode(make_stored_stream({}, 65535)).empty());
+}
+
+TEST_CASE(gzip_decodes_fixed_codes)
+{
+	CHECK(decode(to_string(vectors::fixed_stream)) == get_manifest_text());
+}
+
+TEST_CASE(gzip_decodes_dynamic_codes)
+{
+	CHECK(decode(to_string(vectors::dynamic_stream)) == get_manifest_text());
+}
+
+TEST_CASE(gzip_decodes_codes_longer_than_the_root_table)
+{
+	CHECK(decode(to_string(vectors::long_code_stream)) == get_skewed_text());
+}
+
+TEST_CASE(gzip_decodes_input_split_anywhere)
+{
+	// Incomplete blocks are decoded again once more input arrived, every split point has to give the same result
+	for (const size_t piece_size : {1, 7, 4093})
+	{
+		CHECK(decode(to_string(vectors::fixed_stream), piece_size) == get_manifest_text());
+		CHECK(decode(to_string(vectors::dynamic_stream), piece_size) == get_manifest_text());
+		CHECK(decode(to_string(vectors::long_code_stream), piece_size) == get_skewed_text());
+	}
+
+	const auto data = get_random_data(300 * 1024);
+	const auto stream = make_stored_stream(data, 40000);
+
+	for (const size_t piece_size : {1, 4093, 70000})
+	{
+		CHECK(decode(stream, piece_size) == data);
+	}
+}
+
+TEST_CASE(gzip_rejects_checksum_mismatch)
+{
+	auto stream = to_string(vectors::dynamic_stream);
+	stream[stream.size() - 8] ^= 1;
+	CHECK_THROWS(decode(stream));
+}
+
+TEST_CASE(gzip_rejects_size_mismatch)
+{
+	auto stream = to_string(vectors::dynamic_stream);
+	stream[stream.size() - 4] ^= 1;
+	CHECK_THROWS(decode(stream));
+}
+
+TEST_CASE(gzip_rejects_truncated_input)
+{
+	const auto stream = to_string(vectors::dynamic_stream);
+	CHECK_THROWS(decode(stream.substr(0, stream.size() - 1)));
+	CHECK_THROWS(decode(stream.substr(0, stream.size() / 2), 1));
+	CHECK_THROWS(decode(stream.substr(0, 5)));
+}
+
+TEST_CASE(gzip_rejects_data_after_the_stream)
+{
+	CHECK_THROWS(decode(to_string(vectors::fixed_stream) + "x"));
+}
+
+TEST_CASE(gzip_rejects_invalid_headers_and_blocks)
+{
+	CHECK_THROWS(decode("not a gzip stream"));
+
+	// A final block of the reserved type 3
+	CHECK_THROWS(decode(std::string("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF\x07", 11) + std::string(8, 0)));
+
+	// A stored block whose length doesn't match its complement
+	auto stream = make_stored_stream("abc", 65535);
+	stream[13] ^= 1;
+	CHECK_THROWS(decode(stream));
+}
+
+TEST_CASE(gzip_reset_restarts_the_stream)
+{
+	const auto stream = to_string(vectors::dynamic_stream);
+
+	std::string result{};
+	utils::compression::gzip_decoder decoder{[&result](const std::string_view data)
+	{
+		result.append(data);
+	}};
+
+	decoder.write(stream.data(), stream.size() / 2);
+	decoder.reset();
+	result.clear();
+
+	decoder.write(stream.data(), stream.size());
+	decoder.finish();
+
+	CHECK(result == get_manifest_text());
+}
@@ -0,0 +1,118 @@
+#include "test.hpp"
+
+#include <utils/cryptography.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct known_answer
+	{
+		std::string data;
+		const char* hash;
+	};
+
+	std::vector<known_answer> get_known_answers()
+	{
+		return {
+			{"", "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709"},
+			{"abc", "A9993E364706816ABA3E25717850C26C9CD0D89D"},
+			{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "84983E441C3BD26EBAAE4AA1F95129E5E54670F1"},
+			{"The quick brown fox jumps over the lazy dog", "2FD4E1C67A2D28FCED849EE1BB76E7391B93EB12"},
+			{std::string(1000000, 'a'), "34AA973CD4C4DAA4F61EEB2BDBAD27316534016F"},
+		};
+	}
+
+	std::string get_random_data(const size_t size, uint32_t seed)
+	{
+		std::string data(size, 0);
+		for (auto& value : data)
+		{
+			seed = seed * 1664525 + 1013904223;
+			value = static_cast<char>(seed >> 24);
+		}
+
+		return data;
+	}
+}
+
+TEST_CASE(sha1_implementations_match_known_answers)
+{
+	const auto answers = get_known_answers();
+
+	std::vector<std::string_view> data{};
+	for (const auto& answer : answers)
+	{
+		data.emplace_back(answer.data);
+	}
+
+	const auto implementations = utils::cryptography::sha1::get_implementations();
+	CHECK(!implementations.empty());
+
+	for (const auto* implementation : implementations)
+	{
+		const auto hashes = utils::cryptography::sha1::compute_many_with(implementation, data, true);
+		CHECK(hashes.size() == answers.size());
+
+		for (size_t i = 0; i < hashes.size() && i < answers.size(); ++i)
+		{
+			CHECK(hashes[i] == answers[i].hash);
+		}
+	}
+
+	for (const auto& answer : answers)
+	{
+		CHECK(utils::cryptography::sha1::compute(answer.data, true) == answer.hash);
+	}
+}
+
+TEST_CASE(sha1_implementations_agree_on_every_padding_length)
+{
+	// Lengths around one and two blocks cover every padding layout, mixed lengths make the lanes finish unevenly
+	std::vector<std::string> inputs{};
+	for (size_t length = 0; length <= 200; ++length)
+	{
+		inputs.emplace_back(get_random_data(length, static_cast<uint32_t>(length)));
+	}
+
+	for (size_t i = 0; i < 20; ++i)
+	{
+		inputs.emplace_back(get_random_data(1000 + i * 3989, static_cast<uint32_t>(i)));
+	}
+
+	const std::vector<std::string_view> data(inputs.begin(), inputs.end());
+	const auto expected = utils::cryptography::sha1::compute_many_with("scalar", data);
+
+	for (const auto* implementation : utils::cryptography::sha1::get_implementations())
+	{
+		CHECK(utils::cryptography::sha1::compute_many_with(implementation, data) == expected);
+	}
+
+	CHECK(utils::cryptography::sha1::compute_many(data) == expected);
+	CHECK(utils::cryptography::sha1::compute_many({}).empty());
+}
+
+TEST_CASE(sha1_context_hashes_split_input)
+{
+	const auto data = get_random_data(1000, 1);
+	const auto expected = utils::cryptography::sha1::compute(data);
+
+	for (const size_t piece_size : {1, 7, 63, 64, 65, 999})
+	{
+		utils::cryptography::sha1::context context{};
+		for (size_t offset = 0; offset < data.size(); offset += piece_size)
+		{
+			context.update(data.substr(offset, piece_size));
+		}
+
+		CHECK(context.finalize() == expected);
+	}
+}
+
+TEST_CASE(sha1_rejects_unknown_implementations)
+{
+	CHECK_THROWS(utils::cryptography::sha1::context{"unknown"});
+	CHECK_THROWS(utils::cryptography::sha1::compute_many_with("unknown", {"abc"}));
+}
@@ -0,0 +1,153 @@
+#include "test.hpp"
+
+#include <utils/delta.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct record
+	{
+		std::string diff{};
+		std::string extra{};
+		int64_t seek{};
+	};
+
+	void append_integer(std::string& data, const uint64_t value)
+	{
+		for (auto i = 0; i < 8; ++i)
+		{
+			data.push_back(static_cast<char>(value >> (i * 8)));
+		}
+	}
+
+	std::string make_patch(const uint64_t target_size, const std::vector<record>& records)
+	{
+		std::string patch = "XLDELTA1";
+		append_integer(patch, target_size);
+
+		for (const auto& entry : records)
+		{
+			append_integer(patch, entry.diff.size());
+			append_integer(patch, entry.extra.size());
+			append_integer(patch, static_cast<uint64_t>(entry.seek));
+			patch += entry.diff;
+			patch += entry.extra;
+		}
+
+		return patch;
+	}
+
+	// Bytes that turn the source into the target when added to it
+	std::string make_diff(const std::string_view source, const std::string_view target)
+	{
+		std::string diff(target.size(), 0);
+		for (size_t i = 0; i < target.size(); ++i)
+		{
+			diff[i] = static_cast<char>(target[i] - source[i]);
+		}
+
+		return diff;
+	}
+
+	std::string apply_patch(const std::string_view source, const std::string_view patch)
+	{
+		std::string result{};
+		utils::delta::apply(source, patch, [&result](const std::string_view data)
+		{
+			result.append(data);
+		});
+
+		return result;
+	}
+}
+
+TEST_CASE(delta_applies_diff_and_extra_records)
+{
+	const std::string source = "hello world";
+
+	// "hello" is changed, " there" inserted, the space skipped and "world" kept
+	const auto patch = make_patch(16, {
+		{make_diff("hello", "HELLO"), " there", 1},
+		{make_diff("world", "world"), {}, 0},
+	});
+
+	CHECK(apply_patch(source, patch) == "HELLO thereworld");
+}
+
+TEST_CASE(delta_seeks_backwards_in_the_source)
+{
+	const auto patch = make_patch(10, {
+		{make_diff("abcde", "abcde"), {}, -5},
+		{make_diff("abcde", "ABCDE"), {}, 0},
+	});
+
+	CHECK(apply_patch("abcde", patch) == "abcdeABCDE");
+}
+
+TEST_CASE(delta_outputs_diffs_larger_than_its_buffer)
+{
+	std::string source(300 * 1024, 0);
+	std::string target(source.size(), 0);
+	for (size_t i = 0; i < source.size(); ++i)
+	{
+		source[i] = static_cast<char>(i * 31);
+		target[i] = static_cast<char>(i * 17);
+	}
+
+	CHECK(apply_patch(source, make_patch(target.size(), {{make_diff(source, target), {}, 0}})) == target);
+}
+
+TEST_CASE(delta_applies_empty_targets)
+{
+	CHECK(apply_patch("abc", make_patch(0, {})).empty());
+}
+
+TEST_CASE(delta_rejects_malformed_headers)
+{
+	CHECK_THROWS(apply_patch("abc", ""));
+	CHECK_THROWS(apply_patch("abc", "XLDELTA2" + std::string(8, 0)));
+	CHECK_THROWS(apply_patch("abc", "XLDELTA1\x01"));
+}
+
+TEST_CASE(delta_rejects_truncated_patches)
+{
+	const auto patch = make_patch(6, {{make_diff("abc", "abc"), "def", 0}});
+
+	// Every prefix of a patch is cut somewhere in the header, a record or its data
+	for (size_t length = 0; length < patch.size(); ++length)
+	{
+		CHECK_THROWS(apply_patch("abc", patch.substr(0, length)));
+	}
+
+	CHECK(apply_patch("abc", patch) == "abcdef");
+}
+
+TEST_CASE(delta_rejects_records_beyond_the_target_size)
+{
+	CHECK_THROWS(apply_patch("abc", make_patch(2, {{make_diff("abc", "abc"), {}, 0}})));
+	CHECK_THROWS(apply_patch("abc", make_patch(4, {{make_diff("abc", "abc"), "de", 0}})));
+}
+
+TEST_CASE(delta_rejects_reads_outside_the_source)
+{
+	// Diff longer than the source
+	CHECK_THROWS(apply_patch("ab", make_patch(3, {{std::string(3, 0), {}, 0}})));
+
+	// Seeking past the end or before the start
+	CHECK_THROWS(apply_patch("abc", make_patch(2, {{std::string(1, 0), {}, 5}, {std::string(1, 0), {}, 0}})));
+	CHECK_THROWS(apply_patch("abc", make_patch(2, {{std::string(1, 0), {}, -2}, {std::string(1, 0), {}, 0}})));
+
+	// Seeks that would overflow the source offset
+	constexpr auto max_seek = std::numeric_limits<int64_t>::max();
+	CHECK_THROWS(apply_patch("abc", make_patch(2, {{std::string(1, 0), {}, max_seek}, {std::string(1, 0), {}, 0}})));
+}
+
+TEST_CASE(delta_rejects_trailing_data)
+{
+	CHECK_THROWS(apply_patch("abc", make_patch(3, {{make_diff("abc", "abc"), {}, 0}}) + "x"));
+	CHECK_THROWS(apply_patch("abc", make_patch(0, {}) + "x"));
+}
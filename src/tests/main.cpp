@@ -0,0 +1,65 @@
+#include "test.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+namespace tests
+{
+	namespace
+	{
+		struct test
+		{
+			const char* name;
+			test_function function;
+		};
+
+		// Tests register themselves during static initialization, so the list has to exist before the first one
+		std::vector<test>& get_tests()
+		{
+			static std::vector<test> list{};
+			return list;
+		}
+
+		size_t failures = 0;
+	}
+
+	bool register_test(const char* name, const test_function function)
+	{
+		get_tests().push_back({name, function});
+		return true;
+	}
+
+	void report_failure(const char* expression, const char* file, const int line)
+	{
+		std::fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+		++failures;
+	}
+}
+
+int main()
+{
+	size_t failed_tests = 0;
+
+	for (const auto& test : tests::get_tests())
+	{
+		const auto previous_failures = tests::failures;
+
+		try
+		{
+			test.function();
+		}
+		catch (const std::exception& e)
+		{
+			tests::report_failure(e.what(), test.name, 0);
+		}
+
+		const auto passed = previous_failures == tests::failures;
+		failed_tests += passed ? 0 : 1;
+
+		std::printf("[%s] %s\n", passed ? " OK " : "FAIL", test.name);
+	}
+
+	std::printf("%zu of %zu tests passed\n", tests::get_tests().size() - failed_tests, tests::get_tests().size());
+	return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Stands in for the launcher's precompiled header when its sources are built into the tests, without CEF
+
+#define _HAS_CXX20 1
+#define _HAS_CXX17 1
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+
+#include <Windows.h>
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <set>
+#include <unordered_set>
+#include <unordered_map>
+#include <filesystem>
+
+#include <optional>
+
+#include <gsl/gsl>
+
+#include <rapidjson/document.h>
+
+using namespace std::literals;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdexcept>
+
+namespace tests
+{
+	using test_function = void(*)();
+
+	bool register_test(const char* name, test_function function);
+
+	// Failed checks are reported and counted, the test continues so a single run shows every broken expectation
+	void report_failure(const char* expression, const char* file, int line);
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const bool name##_registered = tests::register_test(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			tests::report_failure(#expression, __FILE__, __LINE__); \
+		} \
+	} \
+	while (false)
+
+#define CHECK_THROWS(expression) \
+	do \
+	{ \
+		auto thrown_ = false; \
+		try \
+		{ \
+			expression; \
+		} \
+		catch (const std::exception&) \
+		{ \
+			thrown_ = true; \
+		} \
+		if (!thrown_) \
+		{ \
+			tests::report_failure("throws " #expression, __FILE__, __LINE__); \
+		} \
+	} \
+	while (false)
@@ -0,0 +1,269 @@
+#include "test.hpp"
+
+#include <std_include.hpp>
+
+#include <updater/update_journal.hpp>
+
+namespace
+{
+	class journal_folder
+	{
+	public:
+		journal_folder()
+			: base_(std::filesystem::temp_directory_path() / "xlabs-journal-tests")
+		{
+			std::error_code code{};
+			std::filesystem::remove_all(this->base_, code);
+			std::filesystem::create_directories(this->get_user_folder(), code);
+			std::filesystem::create_directories(this->get_data_folder(), code);
+		}
+
+		~journal_folder()
+		{
+			std::error_code code{};
+			std::filesystem::remove_all(this->base_, code);
+		}
+
+		journal_folder(journal_folder&&) = delete;
+		journal_folder(const journal_folder&) = delete;
+		journal_folder& operator=(journal_folder&&) = delete;
+		journal_folder& operator=(const journal_folder&) = delete;
+
+		[[nodiscard]] std::filesystem::path get_user_folder() const
+		{
+			return this->base_ / "user";
+		}
+
+		[[nodiscard]] std::filesystem::path get_data_folder() const
+		{
+			return this->base_ / "data";
+		}
+
+		[[nodiscard]] std::filesystem::path get_journal_file() const
+		{
+			return this->get_user_folder() / "update-journal.log";
+		}
+
+		void write_journal(const std::string& data) const
+		{
+			write(this->get_journal_file(), data);
+		}
+
+		void write_staged(const std::string& name, const std::string& data) const
+		{
+			write(this->get_user_folder() / "staging" / name, data);
+		}
+
+		[[nodiscard]] std::string read_data(const std::string& name) const
+		{
+			std::string data{};
+			utils::io::read_file(this->get_data_folder() / name, &data);
+			return data;
+		}
+
+		static void write(const std::filesystem::path& file, const std::string& data)
+		{
+			std::error_code code{};
+			std::filesystem::create_directories(file.parent_path(), code);
+
+			std::ofstream stream(file, std::ios::binary);
+			stream << data;
+		}
+
+	private:
+		std::filesystem::path base_;
+	};
+
+	struct recovery
+	{
+		std::vector<std::string> committed{};
+
+		void run(updater::update_journal& journal, const journal_folder& folder)
+		{
+			journal.recover([&folder](const std::string& name)
+			{
+				return folder.get_data_folder() / name;
+			}, [this](const updater::file_info& file, const std::filesystem::path&)
+			{
+				this->committed.push_back(file.name + "=" + file.hash + "/" + std::to_string(file.size));
+			});
+		}
+	};
+
+	bool is_staged(const updater::update_journal& journal, const std::string& name, const std::string& hash, const size_t size)
+	{
+		return journal.is_staged({name, size, hash});
+	}
+}
+
+TEST_CASE(update_journal_ignores_missing_journals)
+{
+	const journal_folder folder{};
+	updater::update_journal journal{folder.get_user_folder()};
+
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(result.committed.empty());
+	CHECK(!std::filesystem::exists(folder.get_journal_file()));
+}
+
+TEST_CASE(update_journal_reuses_staged_files)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "aaa");
+	folder.write_staged("sub/b c.txt", "bbbb");
+	folder.write_journal("S HA 3 a.txt\nS HB 4 sub/b c.txt\n");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(result.committed.empty());
+	CHECK(is_staged(journal, "a.txt", "HA", 3));
+	CHECK(is_staged(journal, "sub/b c.txt", "HB", 4));
+	CHECK(!is_staged(journal, "a.txt", "HA", 4));
+	CHECK(!is_staged(journal, "a.txt", "HX", 3));
+}
+
+TEST_CASE(update_journal_drops_torn_last_lines)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "aaa");
+	folder.write_staged("b.txt", "bbb");
+	folder.write_journal("S HA 3 a.txt\nS HB 3 b.t");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(is_staged(journal, "a.txt", "HA", 3));
+	CHECK(!is_staged(journal, "b.t", "HB", 3));
+	CHECK(!is_staged(journal, "b.txt", "HB", 3));
+
+	std::string data{};
+	CHECK(utils::io::read_file(folder.get_journal_file(), &data) && data == "S HA 3 a.txt\n");
+}
+
+TEST_CASE(update_journal_skips_malformed_records)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "aaa");
+
+	folder.write_journal(
+		"S\n"
+		"S \n"
+		"S HA\n"
+		"S HA 3\n"
+		"S HA 3 \n"
+		"S HA x a.txt\n"
+		"S HA -3 a.txt\n"
+		"S HA 3x a.txt\n"
+		"S HA 99999999999999999999999 a.txt\n"
+		"SHA 3 a.txt\n"
+		"X HA 3 a.txt\n"
+		"CC\n");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(result.committed.empty());
+	CHECK(!is_staged(journal, "a.txt", "HA", 3));
+	CHECK(folder.read_data("a.txt").empty());
+	CHECK(!std::filesystem::exists(folder.get_journal_file()));
+}
+
+TEST_CASE(update_journal_keeps_the_latest_record_of_a_file)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "aaaa");
+	folder.write_journal("S HA 3 a.txt\nS HB 4 a.txt\n");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(!is_staged(journal, "a.txt", "HA", 3));
+	CHECK(is_staged(journal, "a.txt", "HB", 4));
+}
+
+TEST_CASE(update_journal_forgets_vanished_staged_files)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "aaa");
+	folder.write_journal("S HA 3 a.txt\nS HB 3 b.txt\n");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(is_staged(journal, "a.txt", "HA", 3));
+
+	std::string data{};
+	CHECK(utils::io::read_file(folder.get_journal_file(), &data) && data == "S HA 3 a.txt\n");
+}
+
+TEST_CASE(update_journal_rolls_interrupted_commits_forward)
+{
+	const journal_folder folder{};
+
+	// a.txt was moved before the commit got interrupted, the torn line after the commit record doesn't matter
+	folder.write_staged("sub/b.txt", "new-b");
+	journal_folder::write(folder.get_data_folder() / "a.txt", "new-a");
+	journal_folder::write(folder.get_data_folder() / "sub/b.txt", "old-b");
+	folder.write_journal("S HA 5 a.txt\nS HB 5 sub/b.txt\nC\nS HC 1 c");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK((result.committed == std::vector<std::string>{"sub/b.txt=HB/5"}));
+	CHECK(folder.read_data("a.txt") == "new-a");
+	CHECK(folder.read_data("sub/b.txt") == "new-b");
+	CHECK(!std::filesystem::exists(folder.get_journal_file()));
+	CHECK(!std::filesystem::exists(folder.get_user_folder() / "staging"));
+}
+
+TEST_CASE(update_journal_ignores_torn_commit_records)
+{
+	const journal_folder folder{};
+	folder.write_staged("a.txt", "new-a");
+	folder.write_journal("S HA 5 a.txt\nC");
+
+	updater::update_journal journal{folder.get_user_folder()};
+	recovery result{};
+	result.run(journal, folder);
+
+	CHECK(result.committed.empty());
+	CHECK(folder.read_data("a.txt").empty());
+	CHECK(is_staged(journal, "a.txt", "HA", 5));
+}
+
+TEST_CASE(update_journal_commits_staged_files)
+{
+	const journal_folder folder{};
+	updater::update_journal journal{folder.get_user_folder()};
+
+	recovery result{};
+	result.run(journal, folder);
+
+	journal_folder::write(journal.get_staging_file("a.txt"), "new-a");
+	journal.stage({"a.txt", 5, "HA"});
+
+	// Staging is durable, a fresh journal picks it up
+	{
+		updater::update_journal reloaded{folder.get_user_folder()};
+		result.run(reloaded, folder);
+		CHECK(is_staged(reloaded, "a.txt", "HA", 5));
+	}
+
+	journal.commit([&folder](const std::string& name)
+	{
+		return folder.get_data_folder() / name;
+	}, {});
+
+	CHECK(folder.read_data("a.txt") == "new-a");
+	CHECK(!is_staged(journal, "a.txt", "HA", 5));
+	CHECK(!std::filesystem::exists(folder.get_journal_file()));
+}